@@ -0,0 +1,78 @@
+#ifndef SJTU_DEQUE_ALGORITHM_HPP
+#define SJTU_DEQUE_ALGORITHM_HPP
+
+#include "deque.hpp"
+
+//algorithms over a whole deque, each one runs a plain loop per contiguous segment
+namespace sjtu
+{
+	template<class T, int C, int I, class V>
+	V accumulate(const deque<T, C, I> &d, V init)
+	{
+		d.for_each_segment([&init](const T *p, int len)
+		{
+			for (int i = 0; i < len; i++) init = init + p[i];
+		});
+		return init;
+	}
+
+	template<class T, int C, int I, class V, class BinaryOp>
+	V accumulate(const deque<T, C, I> &d, V init, BinaryOp op)
+	{
+		d.for_each_segment([&init, &op](const T *p, int len)
+		{
+			for (int i = 0; i < len; i++) init = op(init, p[i]);
+		});
+		return init;
+	}
+
+	template<class T, int C, int I, class Pred>
+	int count_if(const deque<T, C, I> &d, Pred pred)
+	{
+		int res = 0;
+		d.for_each_segment([&res, &pred](const T *p, int len)
+		{
+			for (int i = 0; i < len; i++) res += pred(p[i]) ? 1 : 0;
+		});
+		return res;
+	}
+
+	template<class T, int C, int I>
+	int count(const deque<T, C, I> &d, const T &value)
+	{
+		return count_if(d, [&value](const T &x) { return x == value; });
+	}
+
+	//return the first element equal to value, or end(),
+	//the search goes through the const segments so a shared chunk is not copied
+	template<class T, int C, int I>
+	typename deque<T, C, I>::iterator find(deque<T, C, I> &d, const T &value)
+	{
+		int index = 0;
+		static_cast<const deque<T, C, I>&>(d).for_each_segment([&](const T *p, int len)
+		{
+			for (int i = 0; i < len; i++)
+			{
+				if (p[i] == value)
+				{
+					index += i;
+					return false;
+				}
+			}
+			index += len;
+			return true;
+		});
+		return d.begin() + index;
+	}
+
+	template<class T, int C, int I>
+	void fill(deque<T, C, I> &d, const T &value)
+	{
+		d.for_each_segment([&value](T *p, int len)
+		{
+			for (int i = 0; i < len; i++) p[i] = value;
+		});
+	}
+}
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef SJTU_CHANNEL_HPP
+#define SJTU_CHANNEL_HPP
+
+#include "exceptions.hpp"
+#include "deque.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <utility>
+
+namespace sjtu
+{
+	//bounded queue for any number of producer and consumer threads,
+	//push blocks while the channel is full and pop blocks while it is empty,
+	//a batch takes the lock once and wakes the other side once instead of once per element
+	template<class T, int ChunkSize = defaultChunkSize<T>()>
+	class channel
+	{
+	public:
+		//counters for tuning, the times are only collected after set_profiling(true)
+		struct statistics
+		{
+			size_t locks;      //lock acquisitions
+			size_t waits;      //times a thread blocked on a full or empty channel
+			size_t notifies;   //condition variable notifications sent
+			long long holdNs;  //total time the lock was held
+		};
+
+	private:
+		deque<T, ChunkSize> que;
+		int cap;
+		bool closed;
+		int waitingPush, waitingPop;
+		bool profiling;
+		statistics stat;
+		std::mutex lock;
+		std::condition_variable notFull, notEmpty;
+
+		//holds the lock and accounts its hold time, waits release the lock so they pause the clock
+		class Hold
+		{
+		public:
+			channel &ch;
+			std::unique_lock<std::mutex> guard;
+			std::chrono::steady_clock::time_point since;
+
+			explicit Hold(channel &c) : ch(c), guard(c.lock)
+			{
+				ch.stat.locks++;
+				if (ch.profiling) since = std::chrono::steady_clock::now();
+			}
+			~Hold()
+			{
+				if (guard.owns_lock()) release();
+			}
+
+			void pause()
+			{
+				if (ch.profiling) ch.stat.holdNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+			}
+			void resume()
+			{
+				if (ch.profiling) since = std::chrono::steady_clock::now();
+			}
+
+			//block on cv until pred holds, waiting counts the sleepers of that side
+			template<class Pred>
+			void wait(std::condition_variable &cv, int &waiting, Pred pred)
+			{
+				if (pred()) return;
+				ch.stat.waits++;
+				pause();
+				waiting++;
+				do cv.wait(guard); while (!pred());
+				waiting--;
+				resume();
+			}
+
+			void release()
+			{
+				pause();
+				guard.unlock();
+			}
+		};
+
+		//call without the lock, wake at most n of waiting threads
+		void wake(std::condition_variable &cv, int waiting, int n)
+		{
+			if (waiting == 0 || n == 0) return;
+			if (n >= waiting) cv.notify_all();
+			else for (int i = 0; i < n; i++) cv.notify_one();
+		}
+
+		//call with the lock, count the notifications wake() will send
+		void countWake(int waiting, int n)
+		{
+			if (waiting == 0 || n == 0) return;
+			stat.notifies += n >= waiting ? 1 : n;
+		}
+
+		template<class... Args>
+		bool pushOne(Args&&... args)
+		{
+			Hold h(*this);
+			h.wait(notFull, waitingPush, [&] { return closed || que.size() < cap; });
+			if (closed) return false;
+			que.emplace_back(std::forward<Args>(args)...);
+			int sleepers = waitingPop;
+			countWake(sleepers, 1);
+			h.release();
+			wake(notEmpty, sleepers, 1);
+			return true;
+		}
+
+	public:
+		explicit channel(int capacity) : cap(capacity), closed(false), waitingPush(0), waitingPop(0), profiling(false), stat{0, 0, 0, 0}
+		{
+			if (capacity < 1) throw runtime_error();
+		}
+		channel(const channel &other) = delete;
+		channel &operator=(const channel &other) = delete;
+
+		int capacity() const { return cap; }
+
+		//only a snapshot when other threads are active
+		int size()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return que.size();
+		}
+
+		//pushes fail and pops drain what is left after close, sleeping threads are woken
+		void close()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				closed = true;
+			}
+			notFull.notify_all();
+			notEmpty.notify_all();
+		}
+
+		bool is_closed()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return closed;
+		}
+
+		//block while full, false if the channel is closed
+		bool push(const T &value) { return pushOne(value); }
+		bool push(T &&value) { return pushOne(std::move(value)); }
+		template<class... Args>
+		bool emplace(Args&&... args) { return pushOne(std::forward<Args>(args)...); }
+
+		//false instead of blocking when full
+		bool try_push(const T &value)
+		{
+			Hold h(*this);
+			if (closed || que.size() >= cap) return false;
+			que.push_back(value);
+			int sleepers = waitingPop;
+			countWake(sleepers, 1);
+			h.release();
+			wake(notEmpty, sleepers, 1);
+			return true;
+		}
+
+		//push [first, last), as much as fits each time the lock is taken,
+		//return how many were pushed, which is less than the whole range only if the channel was closed
+		template<class InputIt>
+		int push_batch(InputIt first, InputIt last)
+		{
+			int res = 0;
+			while (first != last)
+			{
+				Hold h(*this);
+				h.wait(notFull, waitingPush, [&] { return closed || que.size() < cap; });
+				if (closed) break;
+				int n = 0;
+				for (; first != last && que.size() < cap; ++first, n++) que.push_back(*first);
+				res += n;
+				int sleepers = waitingPop;
+				countWake(sleepers, n);
+				h.release();
+				wake(notEmpty, sleepers, n);
+			}
+			return res;
+		}
+
+		//block while empty, false once the channel is closed and drained
+		bool pop(T &value)
+		{
+			Hold h(*this);
+			h.wait(notEmpty, waitingPop, [&] { return closed || !que.empty(); });
+			if (que.empty()) return false;
+			value = std::move(que.front());
+			que.pop_front();
+			int sleepers = waitingPush;
+			countWake(sleepers, 1);
+			h.release();
+			wake(notFull, sleepers, 1);
+			return true;
+		}
+
+		//false instead of blocking when empty
+		bool try_pop(T &value)
+		{
+			Hold h(*this);
+			if (que.empty()) return false;
+			value = std::move(que.front());
+			que.pop_front();
+			int sleepers = waitingPush;
+			countWake(sleepers, 1);
+			h.release();
+			wake(notFull, sleepers, 1);
+			return true;
+		}
+
+		//block until something is available, then pop up to n elements into out,
+		//return how many were popped, 0 once the channel is closed and drained
+		template<class OutputIt>
+		int pop_batch(OutputIt out, int n)
+		{
+			if (n <= 0) return 0;
+			Hold h(*this);
+			h.wait(notEmpty, waitingPop, [&] { return closed || !que.empty(); });
+			int res = 0;
+			for (; res < n && !que.empty(); res++, ++out)
+			{
+				*out = std::move(que.front());
+				que.pop_front();
+			}
+			int sleepers = waitingPush;
+			countWake(sleepers, res);
+			h.release();
+			wake(notFull, sleepers, res);
+			return res;
+		}
+
+		void set_profiling(bool on)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			profiling = on;
+		}
+
+		statistics stats()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return stat;
+		}
+
+		void reset_stats()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stat = statistics{0, 0, 0, 0};
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,244 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include "deque.hpp"
+#include "channel.hpp"
+using namespace std;
+
+//stress test of channel and a benchmark against a mutex + condition variable deque,
+//reporting throughput, context switches, lock acquisitions and lock hold time
+//g++ -std=c++17 -O2 -pthread channel_test.cpp
+
+const int Producers = 4, Consumers = 4, PerProducer = 500000, Capacity = 1024, Batch = 64;
+
+long long contextSwitches()
+{
+	rusage u;
+	getrusage(RUSAGE_SELF, &u);
+	return u.ru_nvcsw + u.ru_nivcsw;
+}
+
+void stress()
+{
+	const int M = 200000;
+	sjtu::channel<int, 16> ch(100);
+	vector<atomic<char>> taken(Producers * M);
+	vector<thread> producers, consumers;
+	for (int p = 0; p < Producers; p++)
+	{
+		producers.emplace_back([&, p]
+		{
+			vector<int> buf;
+			for (int i = 0; i < M; )
+			{
+				int x = p * M + i;
+				if (i % 7 == 0)
+				{
+					buf.clear();
+					for (int k = 0; k < 300 && i < M; k++, i++) buf.push_back(p * M + i);
+					ch.push_batch(buf.begin(), buf.end());
+				}
+				else if (i % 5 == 0 && ch.try_push(x)) i++;
+				else if (ch.push(x)) i++;
+			}
+		});
+	}
+	atomic<long long> count(0);
+	for (int c = 0; c < Consumers; c++)
+	{
+		consumers.emplace_back([&, c]
+		{
+			int buf[37];
+			while (true)
+			{
+				int got = c % 2 ? ch.pop_batch(buf, 37) : ch.pop(buf[0]);
+				if (got == 0) break;
+				for (int i = 0; i < got; i++)
+				{
+					if (taken[buf[i]].exchange(1))
+					{
+						cout << "stress: " << buf[i] << " taken twice" << endl;
+						exit(1);
+					}
+				}
+				count += got;
+			}
+		});
+	}
+	for (auto &t : producers) t.join();
+	ch.close();
+	for (auto &t : consumers) t.join();
+	int x = 0;
+	if (count != (long long)Producers * M || ch.push(x) || ch.pop(x))
+	{
+		cout << "stress: " << count << " of " << Producers * M << " taken" << endl;
+		exit(1);
+	}
+	cout << "stress: ok" << endl;
+}
+
+//move-only elements go through the channel without being copied
+void moveOnly()
+{
+	const int M = 100000;
+	sjtu::channel<unique_ptr<int>, 16> ch(64);
+	thread producer([&]
+	{
+		for (int i = 0; i < M; i++)
+		{
+			auto p = make_unique<int>(i);
+			if (i % 2) ch.push(std::move(p));
+			else ch.emplace(new int(i));
+		}
+		ch.close();
+	});
+	long long sum = 0;
+	unique_ptr<int> buf[10];
+	for (int round = 0; ; round++)
+	{
+		int got = round % 3 ? ch.pop_batch(buf, 10) : ch.pop(buf[0]);
+		if (got == 0) break;
+		for (int i = 0; i < got; i++) sum += *buf[i];
+		if (ch.try_pop(buf[0])) sum += *buf[0];
+	}
+	producer.join();
+	if (sum != (long long)M * (M - 1) / 2)
+	{
+		cout << "move only: wrong sum " << sum << endl;
+		exit(1);
+	}
+	cout << "move only: ok" << endl;
+}
+
+//the usual wrapper: every push wakes a consumer and every pop takes the lock
+void benchNaive()
+{
+	sjtu::deque<int> que;
+	mutex lock;
+	condition_variable notEmpty, notFull;
+	bool closed = false;
+	long long switches = contextSwitches();
+	auto start = chrono::steady_clock::now();
+	vector<thread> producers, consumers;
+	for (int p = 0; p < Producers; p++)
+	{
+		producers.emplace_back([&]
+		{
+			for (int i = 0; i < PerProducer; i++)
+			{
+				unique_lock<mutex> guard(lock);
+				notFull.wait(guard, [&] { return que.size() < Capacity; });
+				que.push_back(i);
+				notEmpty.notify_one();
+			}
+		});
+	}
+	atomic<long long> sum(0);
+	for (int c = 0; c < Consumers; c++)
+	{
+		consumers.emplace_back([&]
+		{
+			long long s = 0;
+			while (true)
+			{
+				unique_lock<mutex> guard(lock);
+				notEmpty.wait(guard, [&] { return closed || !que.empty(); });
+				if (que.empty()) break;
+				s += que.front();
+				que.pop_front();
+				notFull.notify_one();
+			}
+			sum += s;
+		});
+	}
+	for (auto &t : producers) t.join();
+	{
+		lock_guard<mutex> guard(lock);
+		closed = true;
+	}
+	notEmpty.notify_all();
+	for (auto &t : consumers) t.join();
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if (sum != (long long)Producers * PerProducer * (PerProducer - 1) / 2) cout << "wrong sum" << endl;
+	cout << "mutex + deque:   " << (long long)Producers * PerProducer / sec / 1e6 << " M ops/s, "
+		<< contextSwitches() - switches << " context switches, "
+		<< 2LL * Producers * PerProducer << " locks" << endl;
+}
+
+//profiling reads the clock twice per lock, so it is kept out of the throughput runs
+void benchChannel(bool batch, bool profile)
+{
+	sjtu::channel<int> ch(Capacity);
+	ch.set_profiling(profile);
+	long long switches = contextSwitches();
+	auto start = chrono::steady_clock::now();
+	vector<thread> producers, consumers;
+	for (int p = 0; p < Producers; p++)
+	{
+		producers.emplace_back([&]
+		{
+			int buf[Batch];
+			for (int i = 0; i < PerProducer; )
+			{
+				if (!batch)
+				{
+					ch.push(i++);
+					continue;
+				}
+				int n = 0;
+				for (; n < Batch && i < PerProducer; n++, i++) buf[n] = i;
+				ch.push_batch(buf, buf + n);
+			}
+		});
+	}
+	atomic<long long> sum(0);
+	for (int c = 0; c < Consumers; c++)
+	{
+		consumers.emplace_back([&]
+		{
+			long long s = 0;
+			int buf[Batch];
+			while (true)
+			{
+				int got = batch ? ch.pop_batch(buf, Batch) : ch.pop(buf[0]);
+				if (got == 0) break;
+				for (int i = 0; i < got; i++) s += buf[i];
+			}
+			sum += s;
+		});
+	}
+	for (auto &t : producers) t.join();
+	ch.close();
+	for (auto &t : consumers) t.join();
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if (sum != (long long)Producers * PerProducer * (PerProducer - 1) / 2) cout << "wrong sum" << endl;
+	auto st = ch.stats();
+	cout << (batch ? "channel batch:   " : "channel single:  ");
+	if (profile)
+	{
+		cout << (double)st.holdNs / st.locks << " ns average lock hold, " << (double)st.holdNs / 1e6 << " ms in total" << endl;
+		return;
+	}
+	cout << (long long)Producers * PerProducer / sec / 1e6 << " M ops/s, "
+		<< contextSwitches() - switches << " context switches, "
+		<< st.locks << " locks, " << st.waits << " waits, " << st.notifies << " notifies" << endl;
+}
+
+int main()
+{
+	stress();
+	moveOnly();
+	benchNaive();
+	benchChannel(false, false);
+	benchChannel(true, false);
+	benchChannel(false, true);
+	benchChannel(true, true);
+	return 0;
+}
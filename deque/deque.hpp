@@ -1,154 +1,568 @@
 #ifndef SJTU_DEQUE_HPP
 #define SJTU_DEQUE_HPP
 
+#if __cplusplus < 201703L && (!defined(_MSVC_LANG) || _MSVC_LANG < 201703L)
+#error "this header needs C++17"
+#endif
+
 #include "exceptions.hpp"
 #include <iostream>
 #include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
 
 namespace sjtu
 {
+	//default chunk capacity: as many elements as fit in about 4KB, but at least 16
 	template<class T>
+	constexpr int defaultChunkSize() { return sizeof(T) * 16 >= 4096 ? 16 : 4096 / sizeof(T); }
+
+	//InlineSize elements are kept inside the deque object itself while it has no chunk,
+	//so small deques do not allocate until they outgrow it
+	template<class T, int ChunkSize = defaultChunkSize<T>(), int InlineSize = 0>
 	class deque {
+		static_assert(ChunkSize > 0, "chunk capacity must be positive");
+		static_assert(InlineSize >= 0 && InlineSize <= ChunkSize, "the inline buffer must fit in one chunk");
+
 	private:
-		class Node;
-		struct LLNode
+		//a chunk keeps up to Cap elements in a circular block of raw storage
+		template<int Cap>
+		struct Chunk
 		{
-			T data;
-			LLNode *next, *prev;
-			LLNode(const T &_data) : data(_data), next(nullptr), prev(nullptr) {}
-		};
-		struct LinkedList
-		{
-			LLNode *head, *tail;
-			int size;
-			LinkedList() : head(nullptr), tail(nullptr), size(0) {}
-			LinkedList(const LinkedList &other)
+			int start, size;
+			Chunk *next; //link in the free list of a chunk_pool
+			std::atomic<int> refs; //number of deques sharing this chunk, it is copied before being modified when shared
+			alignas(T) unsigned char buf[Cap * sizeof(T)];
+
+			Chunk() : start(0), size(0), next(nullptr), refs(1) {}
+			Chunk(const Chunk &other) = delete;
+			~Chunk() { clear(); }
+
+			//trivially copyable elements are copied in blocks and need no destructor calls
+			static const bool trivial = std::is_trivially_copyable<T>::value;
+
+			void assign(const Chunk &other)
+			{
+				if (trivial) appendRaw(other, 0, other.size);
+				else for (int i = 0; i < other.size; i++) emplace_back(other[i]);
+			}
+
+			void clear()
 			{
-				head = copyAll(other.head);
-				size = other.size;
+				if (trivial) size = 0;
+				else while (size > 0) pop_back();
+				start = 0;
 			}
-			~LinkedList()
+
+			//append elements [from, from + n) of other with at most three memcpy calls
+			template<int C>
+			void appendRaw(const Chunk<C> &other, int from, int n)
 			{
-				LLNode *t = head;
-				while (t != nullptr)
+				while (n > 0)
 				{
-					LLNode *tmp = t->next;
-					delete t;
-					t = tmp;
+					int src = Chunk<C>::wrap(other.start + from), dst = wrap(start + size);
+					int len = std::min(n, std::min(C - src, Cap - dst));
+					memcpy(buf + dst * sizeof(T), other.buf + src * sizeof(T), len * sizeof(T));
+					from += len, size += len, n -= len;
 				}
 			}
 
-			void merge(LinkedList *other)
+			static int wrap(int i) { return i >= Cap ? i - Cap : i; }
+
+			//call f(ptr, len) for the one or two contiguous runs of the ring
+			template<class F>
+			bool spans(F &f)
+			{
+				int len = std::min(size, Cap - start);
+				if (!visit(f, data() + start, len)) return false;
+				return len == size || visit(f, data(), size - len);
+			}
+			template<class F>
+			bool spans(F &f) const
 			{
-				if (other->size == 0) return;
-				if (head == nullptr) head = other->head;
-				else tail->next = other->head, other->head->prev = tail;
-				tail = other->tail;
-				size += other->size;
-				other->head = other->tail = nullptr;
-				other->size = 0;
+				int len = std::min(size, Cap - start);
+				if (!visit(f, data() + start, len)) return false;
+				return len == size || visit(f, data(), size - len);
 			}
 
-			LLNode* copyAll(LLNode *cur, LLNode *prev = nullptr)
+			//f may return a bool, false stops the walk
+			template<class F, class P>
+			static bool visit(F &f, P p, int len)
 			{
-				if (cur == nullptr) return nullptr;
-				LLNode *t = new LLNode(cur->data);
-				tail = t;
-				t->prev = prev;
-				if (prev != nullptr) prev->next = t;
-				t->next = copyAll(cur->next, t);
-				return t;
+				if constexpr (std::is_void<decltype(f(p, len))>::value)
+				{
+					f(p, len);
+					return true;
+				}
+				else return f(p, len);
 			}
 
-			void push_front(const T &value) //enough size for one more element
+			T* data() { return reinterpret_cast<T*>(buf); }
+			const T* data() const { return reinterpret_cast<const T*>(buf); }
+
+			//move the elements so that they are contiguous in their order, return the first one
+			T* contiguous()
 			{
-				if (size == 0) head = tail = new LLNode(value);
-				else
+				if (start + size <= Cap) return data() + start;
+				int a = Cap - start, e = size - a;
+				if (e < start) //the run [start, Cap) slides down to follow [0, e), then the two runs swap
 				{
-					LLNode *t = new LLNode(value);
-					t->next = head; head->prev = t;
-					head = t;
+					for (int i = 0; i < a; i++)
+					{
+						new (data() + e + i) T(std::move(data()[start + i]));
+						data()[start + i].~T();
+					}
 				}
+				std::rotate(data(), data() + e, data() + size);
+				start = 0;
+				return data();
+			}
+			T& operator[](int i) { return data()[wrap(start + i)]; }
+			const T& operator[](int i) const { return data()[wrap(start + i)]; }
+
+			template<class... Args>
+			void emplace_front(Args&&... args) //enough size for one more element
+			{
+				int pos = (start == 0 ? Cap : start) - 1;
+				new (data() + pos) T(std::forward<Args>(args)...);
+				start = pos;
 				size++;
 			}
 
 			void pop_front()
 			{
+				data()[start].~T();
+				start = wrap(start + 1);
 				size--;
-				if (size == 0) delete head, head = tail = nullptr;
-				else head = head->next, delete head->prev, head->prev = nullptr;
 			}
 
-			void push_back(const T &value)
+			template<class... Args>
+			void emplace_back(Args&&... args)
 			{
-				if (size == 0) head = tail = new LLNode(value);
-				else
-				{
-					LLNode *t = new LLNode(value);
-					t->prev = tail; tail->next = t;
-					tail = t;
-				}
+				new (data() + wrap(start + size)) T(std::forward<Args>(args)...);
 				size++;
 			}
 
 			void pop_back()
 			{
 				size--;
-				if (size == 0) delete head, head = tail = nullptr;
-				else tail = tail->prev, delete tail->next, tail->next = nullptr;
+				data()[wrap(start + size)].~T();
+			}
+
+			//append the first n elements of other, removing them from other
+			void takeFront(Chunk *other, int n)
+			{
+				if (trivial)
+				{
+					appendRaw(*other, 0, n);
+					other->start = wrap(other->start + n);
+					other->size -= n;
+				}
+				else
+				{
+					for (int i = 0; i < n; i++)
+					{
+						emplace_back(std::move((*other)[0]));
+						other->pop_front();
+					}
+				}
+				if (other->size == 0) other->start = 0;
+			}
+
+			//append all elements of other, leaving other empty
+			void merge(Chunk *other) { takeFront(other, other->size); }
+
+			//move elements [pos, size) to the empty chunk other
+			template<int C>
+			void moveTail(int pos, Chunk<C> *other)
+			{
+				if (trivial)
+				{
+					other->appendRaw(*this, pos, size - pos);
+					size = pos;
+					return;
+				}
+				for (int i = pos; i < size; i++) other->emplace_back(std::move((*this)[i]));
+				while (size > pos) pop_back();
 			}
 		};
 
-	private:
-		const int ChunkSize = 512;
-		struct Node
+		typedef Chunk<ChunkSize> Node;
+		struct NoInline {};
+
+	public:
+		//spare chunks kept for reuse instead of going back to the allocator,
+		//a pool may be shared by several deques as long as they are used from one thread
+		class chunk_pool
 		{
-			LinkedList *arr;
-			Node *next, *prev;
+			friend class deque;
+
+		private:
+			Node *freeList;
+			int spare, retention;
+			size_t hits, misses;
+
+		public:
+			explicit chunk_pool(int _retention = 2) : freeList(nullptr), spare(0), retention(_retention), hits(0), misses(0) {}
+			chunk_pool(const chunk_pool &other) = delete;
+			chunk_pool &operator=(const chunk_pool &other) = delete;
+			~chunk_pool() { trim(0); }
+
+			int spare_chunks() const { return spare; }
+			int get_retention() const { return retention; }
+			size_t hit_count() const { return hits; }
+			size_t miss_count() const { return misses; }
+
+			void set_retention(int n)
+			{
+				retention = n;
+				trim(n);
+			}
+
+			//allocate spare chunks until at least n are ready, they may exceed the retention until used
+			void reserve(int n)
+			{
+				while (spare < n)
+				{
+					Node *t = new Node();
+					t->next = freeList;
+					freeList = t;
+					spare++;
+				}
+			}
+
+			//free spare chunks until at most n are left
+			void trim(int n)
+			{
+				while (spare > n)
+				{
+					Node *t = freeList;
+					freeList = t->next;
+					delete t;
+					spare--;
+				}
+			}
+
+		private:
+			Node* acquire()
+			{
+				if (freeList == nullptr)
+				{
+					misses++;
+					return new Node();
+				}
+				hits++;
+				Node *t = freeList;
+				freeList = t->next;
+				spare--;
+				t->refs.store(1, std::memory_order_relaxed);
+				return t;
+			}
 
-			Node() : arr(new LinkedList()), next(nullptr), prev(nullptr) {}
-			Node(const Node &other) : arr(new LinkedList(*other.arr)), next(nullptr), prev(nullptr) {}
-			~Node() { delete arr; }
+			void release(Node *t)
+			{
+				if (spare >= retention)
+				{
+					delete t;
+					return;
+				}
+				t->clear();
+				t->next = freeList;
+				freeList = t;
+				spare++;
+			}
 		};
 
-	public:
-		Node *head, *tail;
+	private:
+		chunk_pool ownPool;
+		chunk_pool *pool;
+
+		//directory of chunk pointers, chunks live in dir[first, last)
+		Node **dir;
+		int mapCap, first, last;
 		int __size;
+		typename std::conditional<(InlineSize > 0), Chunk<InlineSize>, NoInline>::type small; //see inlined()
+		int interior; //total size of the chunks strictly between the first and the last one
+		int *bit; //Fenwick tree over the sizes of those interior chunks, indexed by slot
+		int fingerSlot, fingerBase; //chunk of the last indexed access and the index of its first element, see seek()
 
 	private:
-		//copy all elements, assign tail pointer but not head pointer
-		Node* copyAll(Node *cur, Node *prev = nullptr)
-		{
-			if (cur == nullptr) return nullptr;
-			Node *t = new Node(*cur);
-			tail = t;
-			t->prev = prev;
-			if (prev != nullptr) prev->next = t;
-			t->next = copyAll(cur->next, t);
+		int chunks() const { return last - first; }
+
+		//true while the elements live in the inline buffer, which is whenever there is no chunk
+		bool inlined() const { return InlineSize > 0 && first == last; }
+
+		//move the inline elements to a chunk, before the deque needs more room than the buffer
+		void spill()
+		{
+			if constexpr (InlineSize > 0)
+			{
+				if (!inlined() || small.size == 0) return;
+				Node *t = pool->acquire();
+				small.moveTail(0, t);
+				small.start = 0;
+				if (last == mapCap) growMap();
+				dir[last++] = t;
+			}
+		}
+
+		//move the last k inline elements to index r by three reversals
+		void rotateInline(int r, int k)
+		{
+			if constexpr (InlineSize > 0)
+			{
+				auto reverse = [this](int l, int h)
+				{
+					for (h--; l < h; l++, h--) std::swap(small[l], small[h]);
+				};
+				reverse(r, __size - k);
+				reverse(__size - k, __size);
+				reverse(r, __size);
+			}
+		}
+
+		//erase inline elements [l, r) by swapping them to the back
+		void eraseInline(int l, int r)
+		{
+			if constexpr (InlineSize > 0)
+			{
+				for (int i = l; i + r - l < __size; i++) std::swap(small[i], small[i + r - l]);
+				for (int i = l; i < r; i++) small.pop_back();
+				__size -= r - l;
+			}
+		}
+
+		//true if every chunk other than the first and the last one is full,
+		//then an index can be mapped to its chunk by a division
+		bool uniform() const { return chunks() <= 2 || interior == (chunks() - 2) * ChunkSize; }
+
+		//total size of the interior chunks in slots [0, slot)
+		int bitSum(int slot) const
+		{
+			int res = 0;
+			for (int i = slot; i > 0; i -= i & -i) res += bit[i];
+			return res;
+		}
+
+		void bitAdd(int slot, int delta)
+		{
+			for (int i = slot + 1; i <= mapCap; i += i & -i) bit[i] += delta;
+		}
+
+		//find the interior chunk holding the num-th interior element,
+		//num becomes the offset inside the chunk
+		int bitSearch(int &num) const
+		{
+			int pos = 0, step = 1;
+			while (step * 2 <= mapCap) step *= 2;
+			for (; step > 0; step /= 2)
+			{
+				if (pos + step <= mapCap && bit[pos + step] <= num)
+				{
+					pos += step;
+					num -= bit[pos];
+				}
+			}
+			return pos;
+		}
+
+		//rebuild the Fenwick tree after the directory has been moved or reshaped
+		void rebuild()
+		{
+			interior = 0;
+			fingerSlot = -1;
+			if (bit == nullptr) return;
+			memset(bit, 0, (mapCap + 1) * sizeof(int));
+			for (int i = first + 1; i < last - 1; i++)
+			{
+				bit[i + 1] = dir[i]->size;
+				interior += dir[i]->size;
+			}
+			for (int i = 1; i <= mapCap; i++)
+			{
+				int j = i + (i & -i);
+				if (j <= mapCap) bit[j] += bit[i];
+			}
+		}
+
+		//index of the first element of the chunk in slot
+		int indexOf(int slot) const
+		{
+			if (slot == first) return 0;
+			if (slot == last) return __size;
+			if (uniform()) return dir[first]->size + (slot - first - 1) * ChunkSize;
+			return dir[first]->size + bitSum(slot);
+		}
+
+		//make room for at least extra more slots at both ends of the directory
+		void growMap(int extra = 1)
+		{
+			int used = chunks();
+			if (used * 2 >= mapCap || (mapCap - used) / 2 < extra)
+			{
+				int newCap = mapCap == 0 ? 8 : mapCap * 2;
+				while ((newCap - used) / 2 < extra) newCap *= 2;
+				Node **t = new Node*[newCap];
+				int newFirst = (newCap - used) / 2;
+				if (used > 0) memcpy(t + newFirst, dir + first, used * sizeof(Node*));
+				delete [] dir;
+				delete [] bit;
+				dir = t, mapCap = newCap;
+				bit = new int[mapCap + 1];
+				first = newFirst, last = newFirst + used;
+			}
+			else
+			{
+				int newFirst = (mapCap - used) / 2;
+				memmove(dir + newFirst, dir + first, used * sizeof(Node*));
+				first = newFirst, last = newFirst + used;
+			}
+			rebuild();
+		}
+
+		//give up one reference to a chunk, the last owner recycles it
+		void drop(Node *t)
+		{
+			if (t->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) pool->release(t);
+		}
+
+		Node* clone(const Node *t)
+		{
+			Node *c = pool->acquire();
+			c->assign(*t);
+			return c;
+		}
+
+		//make the chunk in slot private to this deque before it is modified,
+		//a deque of a move-only type cannot be copied, so its chunks are never shared
+		Node* own(int slot)
+		{
+			Node *t = dir[slot];
+			if constexpr (std::is_copy_constructible<T>::value)
+			{
+				if (t->refs.load(std::memory_order_acquire) != 1)
+				{
+					Node *c = clone(t);
+					drop(t);
+					t = dir[slot] = c;
+				}
+			}
 			return t;
 		}
 
-		void __clear(Node *cur)
+		//chunks are shared with other instead of copied
+		void copyAll(const deque &other)
 		{
-			if (cur == nullptr) return;
-			__clear(cur->next);
-			delete cur;
+			if (other.empty()) return;
+			if constexpr (InlineSize > 0)
+			{
+				if (other.inlined())
+				{
+					small.assign(other.small);
+					__size = other.__size;
+					return;
+				}
+			}
+			if (mapCap < other.chunks() + 2)
+			{
+				delete [] dir;
+				delete [] bit;
+				mapCap = other.chunks() * 2 + 2;
+				dir = new Node*[mapCap];
+				bit = new int[mapCap + 1];
+			}
+			first = last = (mapCap - other.chunks()) / 2;
+			for (int i = other.first; i < other.last; i++)
+			{
+				other.dir[i]->refs.fetch_add(1, std::memory_order_relaxed);
+				dir[last++] = other.dir[i];
+			}
+			__size = other.__size;
+			rebuild();
+		}
+
+		//destroy all chunks but keep the directory for reuse
+		void __clear()
+		{
+			if constexpr (InlineSize > 0) small.clear();
+			for (int i = first; i < last; i++) drop(dir[i]);
+			first = last = mapCap / 2;
+			__size = 0;
+			rebuild();
+		}
+
+		//the chunks are relinked, only the elements of the inline buffer are moved one by one
+		static const bool nothrowSteal = InlineSize == 0 || std::is_nothrow_move_constructible<T>::value;
+
+		//take over the directory of other, leaving it empty, this must be empty and have no directory,
+		//if moving an inline element throws, both deques keep the elements they hold by then
+		void steal(deque &other)
+		{
+			if constexpr (InlineSize > 0)
+			{
+				try
+				{
+					small.merge(&other.small);
+				}
+				catch (...)
+				{
+					__size = small.size, other.__size = other.small.size;
+					throw;
+				}
+			}
+			dir = other.dir, bit = other.bit, mapCap = other.mapCap;
+			first = other.first, last = other.last;
+			__size = other.__size, interior = other.interior;
+			other.dir = nullptr, other.bit = nullptr;
+			other.mapCap = other.first = other.last = other.__size = other.interior = 0;
+			fingerSlot = other.fingerSlot = -1;
 		}
 
 	public:
-		deque() : head(nullptr), tail(nullptr), __size(0) { }
-		deque(const deque &other) : __size(other.__size)
+		deque() : pool(&ownPool), dir(nullptr), mapCap(0), first(0), last(0), __size(0), interior(0), bit(nullptr), fingerSlot(-1), fingerBase(0) { }
+		//a copy shares the chunks of other, either deque clones a chunk when it first modifies it,
+		//references, pointers and iterators taken before the copy are not tracked, so writing
+		//through one of them afterwards reaches both deques, access the element again instead
+		deque(const deque &other) : pool(&ownPool), dir(nullptr), mapCap(0), first(0), last(0), __size(0), interior(0), bit(nullptr), fingerSlot(-1), fingerBase(0)
+		{
+			static_assert(std::is_copy_constructible<T>::value, "a deque of a move-only type cannot be copied");
+			copyAll(other);
+		}
+		deque(deque &&other) noexcept(nothrowSteal) : pool(&ownPool), dir(nullptr), mapCap(0), first(0), last(0), __size(0), interior(0), bit(nullptr), fingerSlot(-1), fingerBase(0)
+		{
+			steal(other);
+		}
+		~deque()
 		{
-			head = copyAll(other.head);
+			__clear();
+			delete [] dir;
+			delete [] bit;
 		}
-		~deque()  { __clear(head); }
 
 		deque &operator=(const deque &other)
 		{
+			static_assert(std::is_copy_constructible<T>::value, "a deque of a move-only type cannot be copied");
 			if (this == &other) return *this;
-			__clear(head);
-			head = copyAll(other.head);
-			__size = other.__size;
+			__clear();
+			copyAll(other);
+			return *this;
+		}
+
+		deque &operator=(deque &&other) noexcept(nothrowSteal)
+		{
+			if (this == &other) return *this;
+			__clear();
+			delete [] dir;
+			delete [] bit;
+			dir = nullptr, bit = nullptr;
+			mapCap = first = last = 0;
+			steal(other);
 			return *this;
 		}
 
@@ -157,51 +571,45 @@ namespace sjtu
 		class iterator
 		{
 			friend const_iterator;
-			friend iterator deque<T>::insert(iterator, const T&);
-			friend iterator deque<T>::erase(iterator);
+			friend class deque;
 
 		private:
-			Node *fa;
-			LLNode *cur;
+			Node **fa; //position in the directory
 			int curPos;
-			deque<T> *corres;
+			deque *corres;
 
 		public:
+			//arithmetic is O(1) on a uniform deque (see compact()) and O(log chunks) otherwise
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef int difference_type;
+			typedef T* pointer;
+			typedef T& reference;
+
 			iterator() = default;
 			iterator(const iterator &o) = default;
 			iterator &operator=(const iterator &o) = default;
-			iterator(Node *_fa, LLNode *_cur, int pos, deque *que) : fa(_fa), cur(_cur), curPos(pos), corres(que) {}
+			iterator(Node **_fa, int pos, deque *que) : fa(_fa), curPos(pos), corres(que) {}
 
 		private:
 			int getIndex() const
 			{
-				if (cur == nullptr && curPos == 0) return corres->__size; //end()
-				Node *t = corres->head;
-				int counter;
-				for (counter = 0; t != fa; t = t->next) counter += t->arr->size;
-				counter += curPos;
-				return counter;
+				if (InlineSize > 0 && fa == nullptr) return curPos;
+				return corres->indexOf(fa - corres->dir) + curPos;
 			}
 
 		public:
 			bool valid() const
 			{
-				return fa != nullptr && cur != nullptr && curPos < fa->arr->size && corres != nullptr;
+				if (InlineSize > 0 && fa == nullptr) return corres != nullptr && corres->inlined() && curPos >= 0 && curPos < corres->__size;
+				return corres != nullptr && fa >= corres->dir + corres->first && fa < corres->dir + corres->last && curPos >= 0 && curPos < (*fa)->size;
 			}
 
 			iterator operator+(const int &n) const
 			{
 				if (n == 0) return *this;
-				if (n == 1)
-				{
-					iterator it = *this;
-					return ++it;
-				}
-				if (n == -1)
-				{
-					iterator it = *this;
-					return --it;
-				}
+				if (InlineSize > 0 && fa == nullptr) return corres->find(curPos + n);
+				if (curPos + n >= 0 && fa < corres->dir + corres->last && curPos + n < (*fa)->size) return iterator(fa, curPos + n, corres);
 				return corres->find(getIndex() + n);
 			}
 
@@ -217,13 +625,13 @@ namespace sjtu
 				return getIndex() - rhs.getIndex();
 			}
 
-			iterator operator+=(const int &n)
+			iterator& operator+=(const int &n)
 			{
 				(*this) = (*this) + n;
 				return (*this);
 			}
 
-			iterator operator-=(const int &n)
+			iterator& operator-=(const int &n)
 			{
 				(*this) = (*this) - n;
 				return (*this);
@@ -231,17 +639,14 @@ namespace sjtu
 
 			iterator& operator++()
 			{
-				if (cur == nullptr) throw invalid_iterator();
-				if (cur == fa->arr->tail) //reach the end of the current chunk
+				if (InlineSize > 0 && fa == nullptr)
 				{
-					if (fa->next == nullptr)
-					{
-						fa = nullptr, cur = nullptr, curPos = 0;
-						return *this;
-					}
-					fa = fa->next, cur = fa->arr->head, curPos = 0;
+					if (curPos >= corres->__size) throw invalid_iterator();
+					curPos++;
+					return (*this);
 				}
-				else cur = cur->next, curPos++;
+				if (fa == corres->dir + corres->last) throw invalid_iterator();
+				if (++curPos == (*fa)->size) fa++, curPos = 0; //reach the end of the current chunk
 				return (*this);
 			}
 
@@ -254,19 +659,15 @@ namespace sjtu
 
 			iterator& operator--()
 			{
-				if (corres->empty()) throw invalid_iterator();
-				if (cur == nullptr && curPos == 0) //end() - 1
-				{
-					fa = corres->tail;
-					cur = corres->tail->arr->tail;
-					curPos = corres->tail->arr->size - 1;
-				}
-				else if (cur == fa->arr->head)
+				if (InlineSize > 0 && fa == nullptr)
 				{
-					if (fa->prev == nullptr) throw invalid_iterator();
-					fa = fa->prev, cur = fa->arr->tail, curPos = 0;
+					if (curPos == 0) throw invalid_iterator();
+					curPos--;
+					return (*this);
 				}
-				else cur = cur->prev, curPos--;
+				if (fa == corres->dir + corres->first && curPos == 0) throw invalid_iterator();
+				if (curPos == 0) fa--, curPos = (*fa)->size - 1;
+				else curPos--;
 				return (*this);
 			}
 
@@ -277,23 +678,25 @@ namespace sjtu
 				return tmp;
 			}
 
-			T& operator*() const
+			T& operator*() const { return *operator->(); }
+			//may clone a shared chunk
+			T* operator->() const
 			{
 				if (!valid()) throw invalid_iterator();
-				return cur->data;
-			}
-			T* operator->() const noexcept
-			{
-				return &cur->data;
+				if constexpr (InlineSize > 0)
+				{
+					if (fa == nullptr) return &corres->small[curPos];
+				}
+				return &(*corres->own(fa - corres->dir))[curPos];
 			}
 
 			bool operator==(const iterator &rhs) const
 			{
-				return (corres == rhs.corres) && (fa == rhs.fa) && (cur == rhs.cur) && (curPos == rhs.curPos);
+				return (corres == rhs.corres) && (fa == rhs.fa) && (curPos == rhs.curPos);
 			}
 			bool operator==(const const_iterator &rhs) const
 			{
-				return (corres == rhs.corres) && (fa == rhs.fa) && (cur == rhs.cur) && (curPos == rhs.curPos);
+				return (corres == rhs.corres) && (fa == rhs.fa) && (curPos == rhs.curPos);
 			}
 			bool operator!=(const iterator &rhs) const
 			{
@@ -303,46 +706,66 @@ namespace sjtu
 			{
 				return !((*this) == rhs);
 			}
+
+			T& operator[](int n) const { return *(*this + n); }
+			friend iterator operator+(int n, const iterator &it) { return it + n; }
+			bool operator<(const iterator &rhs) const { return *this - rhs < 0; }
+			bool operator>(const iterator &rhs) const { return *this - rhs > 0; }
+			bool operator<=(const iterator &rhs) const { return *this - rhs <= 0; }
+			bool operator>=(const iterator &rhs) const { return *this - rhs >= 0; }
+			int operator-(const const_iterator &rhs) const { return const_iterator(*this) - rhs; }
+			bool operator<(const const_iterator &rhs) const { return *this - rhs < 0; }
+			bool operator>(const const_iterator &rhs) const { return *this - rhs > 0; }
+			bool operator<=(const const_iterator &rhs) const { return *this - rhs <= 0; }
+			bool operator>=(const const_iterator &rhs) const { return *this - rhs >= 0; }
 		};
 
 		class const_iterator
 		{
+			friend iterator;
+
 		private:
-			Node *fa;
-			LLNode *cur;
+			Node **fa;
 			int curPos;
-			const deque<T> *corres;
+			const deque *corres;
 
 		public:
+			typedef std::random_access_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef int difference_type;
+			typedef const T* pointer;
+			typedef const T& reference;
+
 			const_iterator() = default;
 			const_iterator(const const_iterator &o) = default;
+			const_iterator(const iterator &o) : fa(o.fa), curPos(o.curPos), corres(o.corres) {}
 			const_iterator &operator=(const const_iterator &o) = default;
 			const_iterator &operator=(const iterator &o)
 			{
-				fa = o.fa, cur = o.cur, curPos = o.curPos, corres = o.corres;
+				fa = o.fa, curPos = o.curPos, corres = o.corres;
+				return *this;
 			}
-			const_iterator(Node *_fa, LLNode *_cur, int pos, const deque *que) : fa(_fa), cur(_cur), curPos(pos), corres(que) {}
+			const_iterator(Node **_fa, int pos, const deque *que) : fa(_fa), curPos(pos), corres(que) {}
 
 		private:
 			int getIndex() const
 			{
-				if (cur == nullptr && curPos == 0) return corres->__size; //end()
-				Node *t = corres->head;
-				int counter;
-				for (counter = 0; t != fa; t = t->next) counter += t->arr->size;
-				counter += curPos;
-				return counter;
+				if (InlineSize > 0 && fa == nullptr) return curPos;
+				return corres->indexOf(fa - corres->dir) + curPos;
 			}
 
 		public:
 			bool valid() const
 			{
-				return fa != nullptr && cur != nullptr && curPos < fa->arr->size && corres != nullptr;
+				if (InlineSize > 0 && fa == nullptr) return corres != nullptr && corres->inlined() && curPos >= 0 && curPos < corres->__size;
+				return corres != nullptr && fa >= corres->dir + corres->first && fa < corres->dir + corres->last && curPos >= 0 && curPos < (*fa)->size;
 			}
 
 			const_iterator operator+(const int &n) const
 			{
 				if (n == 0) return *this;
+				if (InlineSize > 0 && fa == nullptr) return corres->find(curPos + n);
+				if (curPos + n >= 0 && fa < corres->dir + corres->last && curPos + n < (*fa)->size) return const_iterator(fa, curPos + n, corres);
 				return corres->find(getIndex() + n);
 			}
 
@@ -358,13 +781,13 @@ namespace sjtu
 				return getIndex() - rhs.getIndex();
 			}
 
-			const_iterator operator+=(const int &n)
+			const_iterator& operator+=(const int &n)
 			{
 				(*this) = (*this) + n;
 				return (*this);
 			}
 
-			const_iterator operator-=(const int &n)
+			const_iterator& operator-=(const int &n)
 			{
 				(*this) = (*this) - n;
 				return (*this);
@@ -372,132 +795,208 @@ namespace sjtu
 
 			const_iterator& operator++()
 			{
-				if (cur == nullptr) throw invalid_iterator();
-				if (cur == fa->arr->tail) //reach the end of the current chunk
+				if (InlineSize > 0 && fa == nullptr)
 				{
-					if (fa->next == nullptr)
-					{
-						fa = nullptr, cur = nullptr, curPos = 0;
-						return *this;
-					}
-					fa = fa->next, cur = fa->arr->head, curPos = 0;
+					if (curPos >= corres->__size) throw invalid_iterator();
+					curPos++;
+					return (*this);
 				}
-				else cur = cur->next, curPos++;
+				if (fa == corres->dir + corres->last) throw invalid_iterator();
+				if (++curPos == (*fa)->size) fa++, curPos = 0; //reach the end of the current chunk
 				return (*this);
 			}
 
 			const_iterator operator++(int)
 			{
-				iterator tmp = *this;
+				const_iterator tmp = *this;
 				++(*this);
 				return tmp;
 			}
 
 			const_iterator& operator--()
 			{
-				if (corres->empty()) throw invalid_iterator();
-				if (cur == nullptr && curPos == 0) //end() - 1
-				{
-					fa = corres->tail;
-					cur = corres->tail->arr->tail;
-					curPos = corres->tail->arr->size - 1;
-				}
-				else if (cur == fa->arr->head)
+				if (InlineSize > 0 && fa == nullptr)
 				{
-					if (fa->prev == nullptr) throw invalid_iterator();
-					fa = fa->prev, cur = fa->arr->tail, curPos = 0;
+					if (curPos == 0) throw invalid_iterator();
+					curPos--;
+					return (*this);
 				}
-				else cur = cur->prev, curPos--;
+				if (fa == corres->dir + corres->first && curPos == 0) throw invalid_iterator();
+				if (curPos == 0) fa--, curPos = (*fa)->size - 1;
+				else curPos--;
 				return (*this);
 			}
 
 			const_iterator operator--(int)
 			{
-				iterator tmp = *this;
+				const_iterator tmp = *this;
 				--(*this);
 				return tmp;
 			}
 
-			const T& operator*() const
+			const T& operator*() const { return *operator->(); }
+			const T* operator->() const
 			{
 				if (!valid()) throw invalid_iterator();
-				return cur->data;
-			}
-			const T* operator->() const noexcept
-			{
-				return &cur->data;
+				if constexpr (InlineSize > 0)
+				{
+					if (fa == nullptr) return &corres->small[curPos];
+				}
+				return &(**fa)[curPos];
 			}
 
 			bool operator==(const const_iterator &rhs) const
 			{
-				return (corres == rhs.corres) && (fa == rhs.fa) && (cur == rhs.cur) && (curPos == rhs.curPos);
+				return (corres == rhs.corres) && (fa == rhs.fa) && (curPos == rhs.curPos);
 			}
 			bool operator!=(const const_iterator &rhs) const
 			{
 				return !(*this == rhs);
 			}
+
+			const T& operator[](int n) const { return *(*this + n); }
+			friend const_iterator operator+(int n, const const_iterator &it) { return it + n; }
+			bool operator<(const const_iterator &rhs) const { return *this - rhs < 0; }
+			bool operator>(const const_iterator &rhs) const { return *this - rhs > 0; }
+			bool operator<=(const const_iterator &rhs) const { return *this - rhs <= 0; }
+			bool operator>=(const const_iterator &rhs) const { return *this - rhs >= 0; }
 		};
 
 	private:
-		iterator find(int num)
+		//map an index to its chunk slot, num becomes the offset inside the chunk
+		int locate(int &num) const
 		{
-			num++;
-			if (num == __size + 1) return end();
-			Node *t = head;
-			while (t != nullptr && num > (t->arr->size))
+			int t = first;
+			if (num < dir[t]->size) return t;
+			num -= dir[t]->size;
+			if (uniform())
 			{
-				num -= t->arr->size;
-				t = t->next;
+				t += 1 + num / ChunkSize;
+				num %= ChunkSize;
+				return t;
 			}
-			LLNode *t2 = t->arr->head;
-			for (int i = 0; i < num - 1; i++, t2 = t2->next);
-			return iterator(t, t2, num - 1, this);
+			if (num >= interior)
+			{
+				num -= interior;
+				return last - 1;
+			}
+			return bitSearch(num);
 		}
 
-		const_iterator find(int num) const
+		//iterators into the inline buffer have no directory position, only an index
+		//locate starting from the finger, sequential and strided index loops cost O(1) per access
+		//even when the chunks are not uniform, the finger is dropped by every structural change
+		int seek(int &num)
 		{
-			if (num == __size + 1) return cend();
-			num++;
-			Node *t = head;
-			while (t != nullptr && num > (t->arr->size))
+			if (fingerSlot >= first && fingerSlot < last)
 			{
-				num -= t->arr->size;
-				t = t->next;
+				int slot = fingerSlot, base = fingerBase;
+				for (int step = 0; step < 4; step++)
+				{
+					if (num < base)
+					{
+						if (slot == first) break;
+						base -= dir[--slot]->size;
+					}
+					else if (num >= base + dir[slot]->size)
+					{
+						base += dir[slot++]->size;
+						if (slot == last) break;
+					}
+					else
+					{
+						fingerSlot = slot, fingerBase = base;
+						num -= base;
+						return slot;
+					}
+				}
 			}
-			if (t == nullptr || num > t->arr->size) return cend();
-			LLNode *t2 = t->arr->head;
-			for (int i = 0; i < num - 1; i++, t2 = t2->next);
-			return const_iterator(t, t2, num - 1, this);
+			int index = num, slot = locate(num);
+			fingerSlot = slot, fingerBase = index - num;
+			return slot;
 		}
 
-	public:
-		iterator begin() { return empty() ? end() : iterator(head, head->arr->head, 0, this); }
-		const_iterator cbegin() const { return empty() ? cend() : const_iterator(head, head->arr->head, 0, this); }
-		iterator end() { return iterator(nullptr, nullptr, 0, this); }
-		const_iterator cend() const { return const_iterator(nullptr, nullptr, 0, this); }
+		//an index outside [0, size] gives an iterator that keeps its distance to the others
+		//but fails valid(), so dereferencing it throws
+		iterator find(int num)
+		{
+			if (inlined()) return iterator(nullptr, num, this);
+			if (num == __size) return end();
+			if (num < 0) return iterator(dir + first, num, this);
+			if (num > __size) return iterator(dir + last, num - __size, this);
+			int t = seek(num);
+			return iterator(dir + t, num, this);
+		}
 
-	private:
-		Node* split(Node *cur, int pos, LLNode *t)
+		const_iterator find(int num) const
 		{
-			Node *newNode = new Node();
-			newNode->arr->head = t;
-			newNode->arr->tail = cur->arr->tail;
-			cur->arr->tail = t->prev;
-			if (cur->arr->tail == nullptr) cur->arr->head = nullptr;
+			if (inlined()) return const_iterator(nullptr, num, this);
+			if (num == __size) return cend();
+			if (num < 0) return const_iterator(dir + first, num, this);
+			if (num > __size) return const_iterator(dir + last, num - __size, this);
+			int t = locate(num);
+			return const_iterator(dir + t, num, this);
+		}
 
-			if (t->prev != nullptr) t->prev->next = nullptr;
-			t->prev = nullptr;
+	public:
+		iterator begin() { return inlined() ? iterator(nullptr, 0, this) : iterator(dir + first, 0, this); }
+		const_iterator cbegin() const { return inlined() ? const_iterator(nullptr, 0, this) : const_iterator(dir + first, 0, this); }
+		iterator end() { return inlined() ? iterator(nullptr, __size, this) : iterator(dir + last, 0, this); }
+		const_iterator cend() const { return inlined() ? const_iterator(nullptr, __size, this) : const_iterator(dir + last, 0, this); }
 
-			newNode->arr->size = cur->arr->size - pos;
-			cur->arr->size = pos;
+	private:
+		//move elements [pos, size) of chunk slot to a new chunk right after it,
+		//return the slot of the original chunk since the directory may be moved
+		int split(int slot, int pos)
+		{
+			Node *newNode = pool->acquire();
+			own(slot)->moveTail(pos, newNode);
+			if (last == mapCap)
+			{
+				slot -= first;
+				growMap();
+				slot += first;
+			}
+			memmove(dir + slot + 2, dir + slot + 1, (last - slot - 1) * sizeof(Node*));
+			dir[slot + 1] = newNode;
+			last++;
+			rebuild();
+			return slot;
+		}
 
-			newNode->next = cur->next;
-			if (newNode->next == nullptr) tail = newNode;
-			if (cur->next != nullptr) cur->next->prev = newNode;
-			cur->next = newNode;
-			newNode->prev = cur;
+		//make the num-th element start a chunk, return the slot of that chunk
+		int cut(int num)
+		{
+			if (num == __size) return last;
+			int slot = locate(num);
+			if (num == 0) return slot;
+			return split(slot, num) + 1;
+		}
 
-			return newNode;
+		//move all chunks of other in front of the chunk in slot (last for the end),
+		//then merge the chunks around both boundaries when they fit
+		void linkBefore(int slot, deque &other)
+		{
+			other.spill();
+			int k = other.chunks();
+			if (k == 0) return;
+			if (mapCap - last < k)
+			{
+				slot -= first;
+				growMap(k);
+				slot += first;
+			}
+			memmove(dir + slot + k, dir + slot, (last - slot) * sizeof(Node*));
+			memcpy(dir + slot, other.dir + other.first, k * sizeof(Node*));
+			last += k;
+			__size += other.__size;
+			other.first = other.last = other.mapCap / 2;
+			other.__size = 0;
+			other.rebuild();
+
+			maintain(slot + k - 1);
+			if (slot > first) maintain(slot - 1);
+			rebuild();
 		}
 
 	public:
@@ -505,76 +1004,454 @@ namespace sjtu
 		{
 			if (empty()) throw container_is_empty();
 			if (pos >= __size || pos < 0) throw index_out_of_bound();
-			return *find(pos);
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined()) return small[pos];
+			}
+			int num = pos;
+			int t = seek(num);
+			return (*own(t))[num];
 		}
 
 		const T& at(const int &pos) const
 		{
 			if (empty()) throw container_is_empty();
 			if (pos >= __size || pos < 0)  throw index_out_of_bound();
-			return *find(pos);
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined()) return small[pos];
+			}
+			int num = pos;
+			int t = locate(num);
+			return (*dir[t])[num];
 		}
 
+		//a non-const access makes the chunk private to this deque, see deque(const deque&)
 		T& operator[](const int &pos) { return at(pos); }
 		const T& operator[](const int &pos) const { return at(pos); }
-		const T& front() const { return (*this)[0]; }
-		const T& back() const { return (*this)[__size - 1]; }
+		const T& front() const
+		{
+			if (empty()) throw container_is_empty();
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined()) return small[0];
+			}
+			return (*dir[first])[0];
+		}
+		const T& back() const
+		{
+			if (empty()) throw container_is_empty();
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined()) return small[__size - 1];
+			}
+			return (*dir[last - 1])[dir[last - 1]->size - 1];
+		}
+		T& front()
+		{
+			if (empty()) throw container_is_empty();
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined()) return small[0];
+			}
+			return (*own(first))[0];
+		}
+		T& back()
+		{
+			if (empty()) throw container_is_empty();
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined()) return small[__size - 1];
+			}
+			Node *t = own(last - 1);
+			return (*t)[t->size - 1];
+		}
 
 		bool empty() const { return __size == 0; }
 		int size() const { return __size; }
 
-		void clear()
+		//chunks released by this deque go to this pool and new chunks are taken from it,
+		//a shared pool must outlive every deque using it
+		chunk_pool& get_pool() { return *pool; }
+		void use_pool(chunk_pool &other) { pool = &other; }
+		void use_own_pool() { pool = &ownPool; }
+
+		void clear() { __clear(); }
+
+		//make sure the next n push_back (or push_front) calls allocate nothing,
+		//the chunks are put in the pool of this deque in advance
+		void reserve_back(int n) { reserveEnd(n, true); }
+		void reserve_front(int n) { reserveEnd(n, false); }
+
+		//repack the elements so that every chunk but the last one is full, in one pass over the chunks,
+		//each element is moved at most once and full chunks that stay in place are not touched
+		void compact()
 		{
-			__clear(head);
-			head = tail = nullptr;
-			__size = 0;
+			if (chunks() <= 1) return;
+			int w = first;
+			for (int r = first + 1; r < last; r++)
+			{
+				int k = std::min(ChunkSize - dir[w]->size, dir[r]->size);
+				if (k > 0) own(w)->takeFront(own(r), k);
+				if (dir[r]->size == 0) drop(dir[r]);
+				else dir[++w] = dir[r];
+			}
+			last = w + 1;
+			rebuild();
+		}
+
+		//compact, then shrink the directory to the chunks in use and free the spare chunks of the own pool
+		void shrink_to_fit()
+		{
+			compact();
+			int used = chunks();
+			Node **t = used > 0 ? new Node*[used + 2] : nullptr;
+			if (used > 0) memcpy(t + 1, dir + first, used * sizeof(Node*));
+			delete [] dir;
+			delete [] bit;
+			mapCap = used > 0 ? used + 2 : 0;
+			dir = t, bit = used > 0 ? new int[mapCap + 1] : nullptr;
+			first = used > 0 ? 1 : 0, last = first + used;
+			rebuild();
+			ownPool.trim(0);
+		}
+
+		//sort each chunk on its own, then merge neighbouring runs of chunks into full chunks,
+		//runs that are already in order are relinked without moving their elements
+		template<class Compare = std::less<T>>
+		void sort(Compare comp = Compare()) { sortChunks(comp, false, 1, runSerial); }
+		template<class Compare = std::less<T>>
+		void stable_sort(Compare comp = Compare()) { sortChunks(comp, true, 1, runSerial); }
+
+		//sort() with the work handed out as tasks, run(n, f) must call f(0) .. f(n - 1), maybe at
+		//the same time, and return when all are done, at most workers tasks are given at a time
+		template<class Compare, class Run>
+		void sort_in_tasks(Compare comp, int workers, Run run) { sortChunks(comp, false, workers < 1 ? 1 : workers, run); }
+
+		struct memory_report
+		{
+			size_t bytesUsed;      //size() * sizeof(T)
+			size_t bytesAllocated; //the deque object, its directory, its chunks and the spare chunks of its own pool
+			int chunks;
+			int fill[11];          //fill[i] chunks are between i * 10% and (i + 1) * 10% full, fill[10] are full
+		};
+
+		//chunks shared with copies of this deque are counted in each copy
+		memory_report memory_usage() const
+		{
+			memory_report res;
+			res.bytesUsed = (size_t)__size * sizeof(T);
+			res.chunks = chunks();
+			res.bytesAllocated = sizeof(deque) + mapCap * sizeof(Node*) + (size_t)(chunks() + ownPool.spare_chunks()) * sizeof(Node);
+			if (bit != nullptr) res.bytesAllocated += (mapCap + 1) * sizeof(int);
+			for (int i = 0; i <= 10; i++) res.fill[i] = 0;
+			for (int i = first; i < last; i++) res.fill[(long long)dir[i]->size * 10 / ChunkSize]++;
+			return res;
+		}
+
+		//call f(T *ptr, int len) for every contiguous run of elements in order,
+		//so that loops over the runs can be vectorized, if f returns false the walk stops there
+		template<class F>
+		void for_each_segment(F f)
+		{
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined() && __size > 0) small.spans(f);
+			}
+			for (int i = first; i < last; i++)
+			{
+				if (!own(i)->spans(f)) return;
+			}
+		}
+		template<class F>
+		void for_each_segment(F f) const
+		{
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined() && __size > 0) small.spans(f);
+			}
+			for (int i = first; i < last; i++)
+			{
+				if (!static_cast<const Node*>(dir[i])->spans(f)) return;
+			}
 		}
 
 	private:
-		void merge(Node *a, Node *b)
+		//merge the chunks following slot into it as long as they fit,
+		//the caller rebuilds the Fenwick tree afterwards
+		void maintain(int slot)
 		{
-			a->arr->merge(b->arr);
-			a->next = b->next;
-			if (b->next != nullptr) b->next->prev = a;
-			delete b;
+			int t = slot + 1;
+			while (t < last && dir[slot]->size + dir[t]->size <= ChunkSize)
+			{
+				own(slot)->merge(own(t));
+				drop(dir[t++]);
+			}
+			if (dir[slot]->size == 0) drop(dir[slot]), slot--;
+			memmove(dir + slot + 1, dir + t, (last - t) * sizeof(Node*));
+			last -= t - slot - 1;
 		}
 
-		void maintain(Node *t)
+		//insert the elements of other before index r, inline if they all fit
+		void insertTemp(int r, deque &other)
 		{
-			if (t == nullptr) t = head;
-			while (t->next != nullptr)
+			if constexpr (InlineSize > 0)
 			{
-				if (t->arr->size + t->next->arr->size <= ChunkSize) merge(t, t->next);
-				else
+				if (inlined())
+				{
+					if (other.inlined() && __size + other.__size <= InlineSize)
+					{
+						int k = other.__size;
+						small.merge(&other.small);
+						other.__size = 0;
+						__size += k;
+						rotateInline(r, k);
+						return;
+					}
+					spill();
+				}
+			}
+			linkBefore(cut(r), other);
+		}
+
+		static constexpr auto runSerial = [](int n, auto f) { for (int i = 0; i < n; i++) f(i); };
+
+		//the second run starts at b, true if it follows the first one without merging
+		template<class Compare>
+		static bool inOrder(Node **b, Node **e, Compare &comp)
+		{
+			return b == e || !comp((**b)[0], (*b[-1])[b[-1]->size - 1]);
+		}
+
+		template<class Compare, class Run>
+		void sortChunks(Compare &comp, bool stable, int workers, Run &run)
+		{
+			auto sortLocal = [&comp, stable](auto *t)
+			{
+				T *p = t->contiguous();
+				if (stable) std::stable_sort(p, p + t->size, comp);
+				else std::sort(p, p + t->size, comp);
+			};
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined())
+				{
+					sortLocal(&small);
+					return;
+				}
+			}
+			int k = chunks();
+			for (int i = first; i < last; i++) own(i);
+			Node **in = dir + first;
+			run(k, [&](int i) { sortLocal(in[i]); });
+			if (k <= 1) return;
+
+			//merge adjacent runs of chunks pass by pass, runs already in order are only relinked,
+			//the pairs of a pass are split into at most workers tasks, each with its own list of
+			//spare chunks that drained inputs go to and outputs come from
+			Node **src = new Node*[k], **dst = new Node*[k];
+			int *bound = new int[k + 1], *nextBound = new int[k + 1]; //run i is src[bound[i], bound[i + 1])
+			Node **spares = new Node*[workers];
+			memcpy(src, dir + first, k * sizeof(Node*));
+			for (int i = 0; i <= k; i++) bound[i] = i;
+			for (int i = 0; i < workers; i++)
+			{
+				//a merge has emptied all but at most two of the inputs it has read from, so two spares
+				//are enough to never run out and the tasks do not touch the pool
+				spares[i] = nullptr;
+				for (int j = 0; workers > 1 && j < 2; j++)
+				{
+					Node *t = pool->acquire();
+					t->next = spares[i];
+					spares[i] = t;
+				}
+			}
+			int runs = k;
+			while (runs > 1)
+			{
+				int pairs = (runs + 1) / 2;
+				auto ends = [&](int i, Node **&a, Node **&b, Node **&e)
+				{
+					a = src + bound[2 * i], b = src + bound[std::min(2 * i + 1, runs)], e = src + bound[std::min(2 * i + 2, runs)];
+				};
+				nextBound[0] = 0;
+				for (int i = 0; i < pairs; i++)
+				{
+					Node **a, **b, **e;
+					ends(i, a, b, e);
+					int n = e - a;
+					if (!inOrder(b, e, comp))
+					{
+						long long total = 0;
+						for (Node **t = a; t < e; t++) total += (*t)->size;
+						n = (total + ChunkSize - 1) / ChunkSize;
+					}
+					nextBound[i + 1] = nextBound[i] + n;
+				}
+				int tasks = std::min(workers, pairs);
+				run(tasks, [&](int w)
+				{
+					for (int i = (long long)pairs * w / tasks; i < (long long)pairs * (w + 1) / tasks; i++)
+					{
+						Node **a, **b, **e;
+						ends(i, a, b, e);
+						if (inOrder(b, e, comp)) memcpy(dst + nextBound[i], a, (e - a) * sizeof(Node*));
+						else mergeRuns(a, b, e, dst + nextBound[i], comp, spares[w]);
+					}
+				});
+				std::swap(src, dst);
+				std::swap(bound, nextBound);
+				runs = pairs;
+			}
+			for (int i = 0; i < workers; i++)
+			{
+				while (spares[i] != nullptr)
 				{
-					t = t->next;
-					break;
+					Node *t = spares[i];
+					spares[i] = t->next;
+					drop(t);
 				}
 			}
-			if (t->next == nullptr) tail = t;
-			if (head->arr->size == 0) delete head, head = tail = nullptr;
+			memcpy(dir + first, src, bound[1] * sizeof(Node*));
+			last = first + bound[1];
+			delete [] src;
+			delete [] dst;
+			delete [] bound;
+			delete [] nextBound;
+			delete [] spares;
+			rebuild();
+		}
+
+		//move the sorted runs of contiguous chunks [a, b) and [b, e) into full chunks at out,
+		//ties go to the first run, drained chunks go to the spare list and are reused for the output,
+		//the pool is only used when the list is empty, return the number of chunks written
+		template<class Compare>
+		int mergeRuns(Node **a, Node **b, Node **e, Node **out, Compare &comp, Node *&spare)
+		{
+			int outs = 0;
+			Node *cur = nullptr;
+			T *w = nullptr, *we = nullptr;
+			auto load = [](Node *t, T *&p, T *&pe)
+			{
+				p = t->data() + t->start;
+				pe = p + t->size;
+			};
+			auto step = [&](Node **&r, Node **end, T *&p, T *&pe)
+			{
+				new (w++) T(std::move(*p));
+				p->~T();
+				if (++p < pe) return;
+				(*r)->size = (*r)->start = 0;
+				(*r)->next = spare;
+				spare = *r;
+				if (++r != end) load(*r, p, pe);
+			};
+			Node **ra = a, **rb = b;
+			T *x, *xe, *y, *ye;
+			load(*ra, x, xe);
+			load(*rb, y, ye);
+			while (ra != b || rb != e)
+			{
+				if (w == we)
+				{
+					if (cur != nullptr) cur->size = ChunkSize;
+					if (spare == nullptr) cur = pool->acquire();
+					else cur = spare, spare = spare->next;
+					out[outs++] = cur;
+					w = cur->data(), we = w + ChunkSize;
+				}
+				if (rb == e || (ra != b && !comp(*y, *x))) step(ra, b, x, xe);
+				else step(rb, e, y, ye);
+			}
+			cur->size = w - cur->data();
+			return outs;
+		}
+
+		void reserveEnd(int n, bool back)
+		{
+			int room = 0;
+			if (inlined())
+			{
+				if (__size + n <= InlineSize) return;
+				n += __size; //they move to a chunk too when the buffer spills
+			}
+			else if (!empty()) room = ChunkSize - (back ? dir[last - 1] : dir[first])->size;
+			if (n <= room) return;
+			int need = (n - room + ChunkSize - 1) / ChunkSize;
+			if ((back ? mapCap - last : first) < need) growMap(need);
+			pool->reserve(need);
 		}
 
 	public:
-		iterator insert(iterator pos, const T &value)
+		template<class... Args>
+		iterator emplace(iterator pos, Args&&... args)
 		{
+			if (pos.corres != this) throw invalid_iterator();
 			if (pos == end())
 			{
-				push_back(value);
-				return iterator(tail, tail->arr->tail, tail->arr->size - 1, this);
+				emplace_back(std::forward<Args>(args)...);
+				if (inlined()) return iterator(nullptr, __size - 1, this);
+				return iterator(dir + last - 1, dir[last - 1]->size - 1, this);
 			}
 			else if (pos == begin())
 			{
-				push_front(value);
+				emplace_front(std::forward<Args>(args)...);
 				return begin();
 			}
 
+			if (!pos.valid()) throw invalid_iterator();
+			T value(std::forward<Args>(args)...); //args may refer to elements moved by split
 			int r = pos.getIndex();
-			if (!pos.valid() || pos.corres != this) throw invalid_iterator();
-			Node *t = split(pos.fa, pos.curPos, pos.cur);
-			t->prev->arr->push_back(value);
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined())
+				{
+					if (__size < InlineSize)
+					{
+						small.emplace_back(std::move(value));
+						__size++;
+						rotateInline(r, 1);
+						return iterator(nullptr, r, this);
+					}
+					spill();
+					pos = find(r);
+				}
+			}
+			int slot = split(pos.fa - dir, pos.curPos);
+			dir[slot]->emplace_back(std::move(value));
 			__size++;
-			maintain(t->prev);
+			maintain(slot);
+			rebuild();
+			return find(r);
+		}
+
+		iterator insert(iterator pos, const T &value) { return emplace(pos, value); }
+		iterator insert(iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+
+		//insert count copies of value before pos, splitting the chunk of pos at most once
+		iterator insert(iterator pos, int count, const T &value)
+		{
+			if (pos.corres != this) throw invalid_iterator();
+			if (pos != end() && !pos.valid()) throw invalid_iterator();
+			int r = pos.getIndex();
+			deque tmp; //filled into whole chunks, value may refer to an element of this deque
+			tmp.pool = pool;
+			for (int i = 0; i < count; i++) tmp.emplace_back(value);
+			insertTemp(r, tmp);
+			return find(r);
+		}
+
+		//insert [from, to) before pos, splitting the chunk of pos at most once
+		template<class InputIt, class = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+		iterator insert(iterator pos, InputIt from, InputIt to)
+		{
+			if (pos.corres != this) throw invalid_iterator();
+			if (pos != end() && !pos.valid()) throw invalid_iterator();
+			int r = pos.getIndex();
+			deque tmp;
+			tmp.pool = pool;
+			for (; from != to; ++from) tmp.emplace_back(*from);
+			insertTemp(r, tmp);
 			return find(r);
 		}
 
@@ -593,67 +1470,190 @@ namespace sjtu
 			}
 
 			int r = pos.getIndex();
-			Node *t = split(pos.fa, pos.curPos, pos.cur);
-			t->arr->pop_front();
+			if (inlined())
+			{
+				eraseInline(r, r + 1);
+				return iterator(nullptr, r, this);
+			}
+			int slot = split(pos.fa - dir, pos.curPos);
+			dir[slot + 1]->pop_front();
 			__size--;
-			maintain(t->prev);
+			maintain(slot);
+			rebuild();
 			return find(r);
 		}
 
-		void push_back(const T &value)
+		//erase [from, to), whole chunks in between are dropped directly
+		iterator erase(iterator from, iterator to)
 		{
-			if (empty()) head = tail = new Node();
-			else if (tail->arr->size == ChunkSize)
+			if (from.corres != this || to.corres != this) throw invalid_iterator();
+			int l = from.getIndex(), r = to.getIndex();
+			if (l > r || (from != end() && !from.valid())) throw invalid_iterator();
+			if (l == r) return find(l);
+			if (inlined())
 			{
-				Node *t = new Node();
-				tail->next = t;
-				t->prev = tail;
-				tail = t;
+				eraseInline(l, r);
+				return find(l);
 			}
-			tail->arr->push_back(value);
+
+			cut(r);
+			int sa = cut(l), num = r;
+			int sb = r == __size ? last : locate(num);
+			for (int i = sa; i < sb; i++) drop(dir[i]);
+			memmove(dir + sa, dir + sb, (last - sb) * sizeof(Node*));
+			last -= sb - sa;
+			__size -= r - l;
+			if (sa > first && sa < last) maintain(sa - 1);
+			rebuild();
+			return find(l);
+		}
+
+		//move all elements of other in front of pos by relinking its chunks,
+		//only the chunks around the two boundaries are touched
+		void splice(iterator pos, deque &other)
+		{
+			if (pos.corres != this) throw invalid_iterator();
+			if (&other == this) throw runtime_error();
+			if (pos != end() && !pos.valid()) throw invalid_iterator();
+			insertTemp(pos.getIndex(), other);
+		}
+
+		void append(deque &&other) { splice(end(), other); }
+
+		//keep [0, index) and return the elements [index, size) in a new deque
+		deque split_at(int index)
+		{
+			if (index < 0 || index > __size) throw index_out_of_bound();
+			deque res;
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined())
+				{
+					for (int i = index; i < __size; i++) res.small.emplace_back(std::move(small[i]));
+					res.__size = __size - index;
+					eraseInline(index, __size);
+					return res;
+				}
+			}
+			int slot = cut(index), k = last - slot;
+			if (k == 0) return res;
+			res.growMap(k);
+			memcpy(res.dir + res.first, dir + slot, k * sizeof(Node*));
+			res.last = res.first + k;
+			res.__size = __size - index;
+			res.rebuild();
+			last = slot;
+			__size = index;
+			rebuild();
+			return res;
+		}
+
+		template<class... Args>
+		void emplace_back(Args&&... args)
+		{
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined())
+				{
+					if (__size < InlineSize)
+					{
+						small.emplace_back(std::forward<Args>(args)...);
+						__size++;
+						return;
+					}
+					T value(std::forward<Args>(args)...); //args may refer to an inline element
+					spill();
+					emplace_back(std::move(value));
+					return;
+				}
+			}
+			if (empty() || dir[last - 1]->size == ChunkSize)
+			{
+				if (last == mapCap) growMap();
+				if (chunks() >= 2) interior += dir[last - 1]->size, bitAdd(last - 1, dir[last - 1]->size);
+				dir[last++] = pool->acquire();
+			}
+			own(last - 1)->emplace_back(std::forward<Args>(args)...);
 			__size++;
 		}
 
+		void push_back(const T &value) { emplace_back(value); }
+		void push_back(T &&value) { emplace_back(std::move(value)); }
+
 		void pop_back()
 		{
 			if (empty()) throw container_is_empty();
-			tail->arr->pop_back();
-			if (tail->arr->size == 0)
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined())
+				{
+					small.pop_back();
+					__size--;
+					return;
+				}
+			}
+			own(last - 1)->pop_back();
+			if (dir[last - 1]->size == 0)
 			{
-				Node *tmp = tail->prev;
-				delete tail;
-				tail = tmp;
-				if (tail != nullptr) tail->next = nullptr;
-				else head = nullptr;
+				drop(dir[--last]);
+				if (fingerSlot >= last) fingerSlot = -1;
+				if (chunks() >= 2) interior -= dir[last - 1]->size, bitAdd(last - 1, -dir[last - 1]->size);
 			}
 			__size--;
 		}
 
-		void push_front(const T &value)
+		template<class... Args>
+		void emplace_front(Args&&... args)
 		{
-			if (empty()) head = tail = new Node();
-			else if (head->arr->size == ChunkSize)
+			if constexpr (InlineSize > 0)
 			{
-				Node *t = new Node();
-				t->next = head;
-				head->prev = t;
-				head = t;
+				if (inlined())
+				{
+					if (__size < InlineSize)
+					{
+						small.emplace_front(std::forward<Args>(args)...);
+						__size++;
+						return;
+					}
+					T value(std::forward<Args>(args)...);
+					spill();
+					emplace_front(std::move(value));
+					return;
+				}
+			}
+			if (empty() || dir[first]->size == ChunkSize)
+			{
+				if (first == 0) growMap();
+				if (chunks() >= 2) interior += dir[first]->size, bitAdd(first, dir[first]->size);
+				dir[--first] = pool->acquire();
 			}
-			head->arr->push_front(value);
+			own(first)->emplace_front(std::forward<Args>(args)...);
+			if (fingerSlot != first) fingerBase++; //every index after the first chunk moved
 			__size++;
 		}
 
+		void push_front(const T &value) { emplace_front(value); }
+		void push_front(T &&value) { emplace_front(std::move(value)); }
+
 		void pop_front()
 		{
 			if (empty()) throw container_is_empty();
-			head->arr->pop_front();
-			if (head->arr->size == 0)
-			{
-				Node *tmp = head->next;
-				delete head;
-				head = tmp;
-				if (head != nullptr) head->prev = nullptr;
-				else tail = nullptr;
+			if constexpr (InlineSize > 0)
+			{
+				if (inlined())
+				{
+					small.pop_front();
+					__size--;
+					return;
+				}
+			}
+			own(first)->pop_front();
+			if (fingerSlot != first) fingerBase--;
+			if (dir[first]->size == 0)
+			{
+				drop(dir[first++]);
+				if (fingerSlot < first) fingerSlot = -1;
+				if (chunks() >= 2) interior -= dir[first]->size, bitAdd(first, -dir[first]->size);
 			}
 			__size--;
 		}
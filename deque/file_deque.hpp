@@ -0,0 +1,353 @@
+#ifndef SJTU_FILE_DEQUE_HPP
+#define SJTU_FILE_DEQUE_HPP
+
+#include "exceptions.hpp"
+#include "deque.hpp"
+#include <climits>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sjtu
+{
+	//deque kept in a file, only a fixed number of chunks are resident in memory at a time,
+	//the others are paged in on access and written back when evicted (least recently used first)
+	//
+	//element p of the deque sits at the absolute position head + p, chunk k covers positions
+	//[k * ChunkSize, (k + 1) * ChunkSize) and is stored in any page of the file, so the end
+	//operations only touch the first and the last chunk while the middle ones stay on disk
+	//
+	//the file is consistent after flush() and after destruction, it can then be reopened,
+	//the first write to the file after that marks the header as stale, so a file left behind
+	//by a crash in between is refused on open instead of being restored half old and half new
+	template<class T, int ChunkSize = defaultChunkSize<T>()>
+	class file_deque
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "elements are stored as raw bytes");
+		static_assert(ChunkSize > 0, "chunk capacity must be positive");
+
+	private:
+		static const int HeaderBytes = 4096;
+		static const long long PageBytes = (long long)ChunkSize * sizeof(T);
+		static const long long Unused = LLONG_MIN; //chunk numbers go negative after push_front
+
+		struct Header
+		{
+			char magic[8];
+			long long elemSize, chunkSize;
+			long long head, tail, firstChunk;
+			long long pageCount, tableLen, freeLen;
+		};
+
+		//a resident chunk
+		struct Frame
+		{
+			long long chunk; //Unused for a free frame
+			bool dirty;
+			unsigned long long used; //time of the last access
+			T *data;
+		};
+
+		int fd;
+		long long head, tail; //elements live in positions [head, tail)
+		long long firstChunk;
+		deque<long long> pageOf; //page of chunk firstChunk + i
+		std::vector<long long> freePages;
+		long long pageCount;
+
+		std::vector<Frame> frames;
+		std::unordered_map<long long, int> where; //chunk -> frame
+		unsigned long long clock;
+		size_t pageIns, pageOuts, hits;
+		bool clean; //the header on disk describes the file
+
+	private:
+		static long long chunkOf(long long p) { return p >= 0 ? p / ChunkSize : -((-p + ChunkSize - 1) / ChunkSize); }
+
+		static void readAt(int fd, void *buf, long long len, long long offset)
+		{
+			char *p = static_cast<char*>(buf);
+			while (len > 0)
+			{
+				ssize_t n = pread(fd, p, len, offset);
+				if (n <= 0) throw runtime_error();
+				p += n, len -= n, offset += n;
+			}
+		}
+
+		static void writeAt(int fd, const void *buf, long long len, long long offset)
+		{
+			const char *p = static_cast<const char*>(buf);
+			while (len > 0)
+			{
+				ssize_t n = pwrite(fd, p, len, offset);
+				if (n <= 0) throw runtime_error();
+				p += n, len -= n, offset += n;
+			}
+		}
+
+		static long long pageOffset(long long page) { return HeaderBytes + page * PageBytes; }
+
+		//call before anything in the file is overwritten
+		void touch()
+		{
+			if (!clean) return;
+			writeAt(fd, "SJTUFDQ!", 8, 0);
+			clean = false;
+		}
+
+		void writeBack(Frame &f)
+		{
+			if (!f.dirty) return;
+			touch();
+			writeAt(fd, f.data, PageBytes, pageOffset(pageOf[f.chunk - firstChunk]));
+			f.dirty = false;
+			pageOuts++;
+		}
+
+		//the frame holding chunk, paging it in if load is set, otherwise its old content is garbage
+		Frame& frame(long long chunk, bool load = true)
+		{
+			auto it = where.find(chunk);
+			if (it != where.end())
+			{
+				hits++;
+				Frame &f = frames[it->second];
+				f.used = ++clock;
+				return f;
+			}
+			int victim = 0;
+			for (int i = 1; i < (int)frames.size() && frames[victim].chunk != Unused; i++)
+			{
+				if (frames[i].chunk == Unused || frames[i].used < frames[victim].used) victim = i;
+			}
+			Frame &f = frames[victim];
+			if (f.chunk != Unused)
+			{
+				writeBack(f);
+				where.erase(f.chunk);
+			}
+			f.chunk = chunk;
+			f.dirty = false;
+			f.used = ++clock;
+			where[chunk] = victim;
+			if (load)
+			{
+				readAt(fd, f.data, PageBytes, pageOffset(pageOf[chunk - firstChunk]));
+				pageIns++;
+			}
+			return f;
+		}
+
+		//forget the resident copy of a chunk without writing it back
+		void discard(long long chunk)
+		{
+			auto it = where.find(chunk);
+			if (it == where.end()) return;
+			frames[it->second].chunk = Unused;
+			frames[it->second].dirty = false;
+			where.erase(it);
+		}
+
+		long long newPage()
+		{
+			if (freePages.empty()) return pageCount++;
+			long long page = freePages.back();
+			freePages.pop_back();
+			return page;
+		}
+
+		//drop every chunk once the deque becomes empty
+		void reset()
+		{
+			for (int i = 0; i < pageOf.size(); i++)
+			{
+				discard(firstChunk + i);
+				freePages.push_back(pageOf[i]);
+			}
+			pageOf.clear();
+			head = tail = firstChunk = 0;
+		}
+
+		T& element(long long p, bool write)
+		{
+			Frame &f = frame(chunkOf(p));
+			if (write) f.dirty = true;
+			return f.data[p - chunkOf(p) * ChunkSize];
+		}
+
+		void load()
+		{
+			Header h;
+			readAt(fd, &h, sizeof(h), 0);
+			if (memcmp(h.magic, "SJTUFDQ1", 8) != 0 || h.elemSize != (long long)sizeof(T) || h.chunkSize != ChunkSize) throw runtime_error();
+			head = h.head, tail = h.tail, firstChunk = h.firstChunk, pageCount = h.pageCount;
+			std::vector<long long> table(h.tableLen);
+			freePages.resize(h.freeLen);
+			long long offset = pageOffset(pageCount);
+			if (h.tableLen > 0) readAt(fd, table.data(), h.tableLen * sizeof(long long), offset);
+			if (h.freeLen > 0) readAt(fd, freePages.data(), h.freeLen * sizeof(long long), offset + h.tableLen * sizeof(long long));
+			for (long long x : table) pageOf.push_back(x);
+			clean = true;
+		}
+
+	public:
+		//open the deque stored in path, or create an empty one if the file does not exist,
+		//at most resident chunks are kept in memory
+		explicit file_deque(const std::string &path, int resident = 8)
+			: head(0), tail(0), firstChunk(0), pageCount(0), clock(0), pageIns(0), pageOuts(0), hits(0), clean(false)
+		{
+			if (resident < 2) resident = 2; //the two ends
+			fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+			if (fd < 0) throw runtime_error();
+			try
+			{
+				if (lseek(fd, 0, SEEK_END) > 0) load();
+			}
+			catch (...)
+			{
+				close(fd);
+				throw;
+			}
+			frames.resize(resident);
+			for (auto &f : frames)
+			{
+				f.chunk = Unused;
+				f.dirty = false;
+				f.used = 0;
+				f.data = static_cast<T*>(::operator new(PageBytes));
+			}
+		}
+		file_deque(const file_deque &other) = delete;
+		file_deque &operator=(const file_deque &other) = delete;
+		~file_deque()
+		{
+			try
+			{
+				flush();
+			}
+			catch (...) {}
+			for (auto &f : frames) ::operator delete(f.data);
+			close(fd);
+		}
+
+		//write the dirty chunks and the chunk table, after this the file can be reopened
+		void flush()
+		{
+			touch(); //the table below may be rewritten even if no chunk is dirty
+			for (auto &f : frames) if (f.chunk != Unused) writeBack(f);
+			std::vector<long long> table;
+			for (int i = 0; i < pageOf.size(); i++) table.push_back(pageOf[i]);
+			long long offset = pageOffset(pageCount);
+			if (!table.empty()) writeAt(fd, table.data(), table.size() * sizeof(long long), offset);
+			if (!freePages.empty()) writeAt(fd, freePages.data(), freePages.size() * sizeof(long long), offset + table.size() * sizeof(long long));
+			if (ftruncate(fd, offset + (table.size() + freePages.size()) * sizeof(long long)) != 0) throw runtime_error();
+			Header h;
+			memset(&h, 0, sizeof(h));
+			memcpy(h.magic, "SJTUFDQ1", 8);
+			h.elemSize = sizeof(T), h.chunkSize = ChunkSize;
+			h.head = head, h.tail = tail, h.firstChunk = firstChunk;
+			h.pageCount = pageCount, h.tableLen = table.size(), h.freeLen = freePages.size();
+			writeAt(fd, &h, sizeof(h), 0);
+			clean = true;
+		}
+
+		long long size() const { return tail - head; }
+		bool empty() const { return head == tail; }
+
+		//chunks read from and written to the file, and accesses served by a resident chunk
+		size_t page_in_count() const { return pageIns; }
+		size_t page_out_count() const { return pageOuts; }
+		size_t hit_count() const { return hits; }
+		int resident_chunks() const { return where.size(); }
+
+		void push_back(const T &value)
+		{
+			long long k = chunkOf(tail);
+			if (empty() || tail == k * ChunkSize)
+			{
+				if (empty()) firstChunk = k;
+				pageOf.push_back(newPage());
+				frame(k, false);
+			}
+			element(tail, true) = value;
+			tail++;
+		}
+
+		void push_front(const T &value)
+		{
+			long long k = chunkOf(head - 1);
+			if (empty() || head == (k + 1) * ChunkSize)
+			{
+				pageOf.push_front(newPage());
+				firstChunk = k;
+				frame(k, false);
+			}
+			head--;
+			element(head, true) = value;
+		}
+
+		void pop_front()
+		{
+			if (empty()) throw container_is_empty();
+			head++;
+			if (head == tail) reset();
+			else if (head == (firstChunk + 1) * ChunkSize)
+			{
+				discard(firstChunk);
+				freePages.push_back(pageOf[0]);
+				pageOf.pop_front();
+				firstChunk++;
+			}
+		}
+
+		void pop_back()
+		{
+			if (empty()) throw container_is_empty();
+			tail--;
+			long long k = chunkOf(tail);
+			if (head == tail) reset();
+			else if (tail == k * ChunkSize)
+			{
+				discard(k);
+				freePages.push_back(pageOf[pageOf.size() - 1]);
+				pageOf.pop_back();
+			}
+		}
+
+		//references stay valid until the next operation on the deque
+		const T& front()
+		{
+			if (empty()) throw container_is_empty();
+			return element(head, false);
+		}
+		const T& back()
+		{
+			if (empty()) throw container_is_empty();
+			return element(tail - 1, false);
+		}
+
+		T& at(long long pos)
+		{
+			if (pos < 0 || pos >= size()) throw index_out_of_bound();
+			return element(head + pos, true);
+		}
+		const T& get(long long pos)
+		{
+			if (pos < 0 || pos >= size()) throw index_out_of_bound();
+			return element(head + pos, false);
+		}
+		T& operator[](long long pos) { return at(pos); }
+
+		void clear()
+		{
+			if (!empty()) reset();
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "file_deque.hpp"
+using namespace std;
+
+//checks of file_deque against std::deque: reopening, refusing a file written after its last flush,
+//least recently used eviction with a small frame budget, and a benchmark of a long queue
+//g++ -std=c++17 -O2 file_deque_test.cpp
+
+const char *Path = "file_deque_test.fdq";
+const int Chunk = 16;
+
+typedef sjtu::file_deque<long long, Chunk> Deque;
+
+void fail(const char *what)
+{
+	cout << what << endl;
+	remove(Path);
+	exit(1);
+}
+
+void same(Deque &d, const std::deque<long long> &s, const char *what)
+{
+	if (d.size() != (long long)s.size()) fail(what);
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		if (d.get(i) != s[i]) fail(what);
+	}
+}
+
+void reopen()
+{
+	remove(Path);
+	std::deque<long long> s;
+	for (int round = 0; round < 50; round++)
+	{
+		Deque d(Path, 2 + round % 4);
+		same(d, s, "reopen: the content differs after reopening");
+		for (int i = 0; i < 200; i++)
+		{
+			long long v = rand();
+			switch (rand() % 6)
+			{
+				case 0: case 1: d.push_back(v), s.push_back(v); break;
+				case 2: d.push_front(v), s.push_front(v); break;
+				case 3: if (!s.empty()) d.pop_front(), s.pop_front(); break;
+				case 4: if (!s.empty()) d.pop_back(), s.pop_back(); break;
+				default: if (!s.empty()) { int p = rand() % s.size(); d[p] = v, s[p] = v; }
+			}
+		}
+		if (round % 2 == 0) d.flush(); //otherwise the destructor does it
+	}
+	cout << "reopen: ok" << endl;
+}
+
+//writes in a child that exits without flushing, as a crash would
+void crash(bool writeAfterFlush)
+{
+	remove(Path);
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		Deque d(Path, 2);
+		for (int i = 0; i < 1000; i++) d.push_back(i);
+		d.flush();
+		if (writeAfterFlush)
+		{
+			for (int i = 0; i < 100; i++) d.push_front(-i);
+			d[500] = 0;
+		}
+		_exit(0);
+	}
+	waitpid(pid, nullptr, 0);
+	try
+	{
+		Deque d(Path, 2);
+		if (writeAfterFlush) fail("crash: a file written after its last flush was opened");
+		std::deque<long long> s;
+		for (int i = 0; i < 1000; i++) s.push_back(i);
+		same(d, s, "crash: the flushed content differs");
+	}
+	catch (sjtu::runtime_error &)
+	{
+		if (!writeAfterFlush) fail("crash: a flushed file was refused");
+	}
+}
+
+void eviction()
+{
+	remove(Path);
+	{
+		Deque d(Path, 3);
+		for (int i = 0; i < Chunk * 10; i++) d.push_back(i);
+	}
+	Deque d(Path, 3); //nothing resident
+	auto at = [&](int chunk)
+	{
+		if (d.get(chunk * Chunk + 1) != chunk * Chunk + 1) fail("eviction: wrong element");
+	};
+	auto counts = [&](size_t ins, size_t hits)
+	{
+		return d.page_in_count() == ins && d.hit_count() == hits && d.resident_chunks() <= 3;
+	};
+	at(0), at(1), at(2);
+	if (!counts(3, 0)) fail("eviction: the first accesses were not paged in");
+	at(0); //chunk 1 is now the least recently used one
+	at(3);
+	if (!counts(4, 1)) fail("eviction: a resident chunk was paged in again");
+	at(0), at(2);
+	if (!counts(4, 3)) fail("eviction: a recently used chunk was evicted");
+	at(1);
+	if (!counts(5, 3)) fail("eviction: the least recently used chunk stayed resident");
+	if (d.page_out_count() != 0) fail("eviction: clean chunks were written back");
+	d[Chunk * 5] = -1; //chunk 5 is dirty and evicted by the third access to another chunk
+	at(6), at(7);
+	if (d.page_out_count() != 0) fail("eviction: a dirty chunk was evicted too early");
+	at(8);
+	if (d.page_out_count() != 1) fail("eviction: a dirty chunk was not written back");
+	if (d.get(Chunk * 5) != -1) fail("eviction: a written back chunk lost its content");
+	cout << "eviction: ok" << endl;
+}
+
+int main()
+{
+	reopen();
+	crash(false);
+	crash(true);
+	cout << "crash: ok" << endl;
+	eviction();
+
+	//a queue far longer than the resident chunks, only its two ends are touched
+	remove(Path);
+	const long long N = 5000000;
+	auto start = chrono::steady_clock::now();
+	{
+		sjtu::file_deque<long long> q(Path, 4);
+		for (long long i = 0; i < N; i++)
+		{
+			q.push_back(i);
+			if (i % 2 == 0 && q.front() == i / 2) q.pop_front();
+		}
+		long long sum = 0;
+		while (!q.empty()) sum += q.front(), q.pop_front();
+		if (sum != (N - 1 + N / 2) * (N / 2) / 2) cout << "wrong sum" << endl;
+		cout << "queue of " << N << " elements, 4 resident chunks: page ins " << q.page_in_count() << ", page outs " << q.page_out_count();
+	}
+	cout << ", " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+	remove(Path);
+	return 0;
+}
@@ -0,0 +1,160 @@
+#ifndef SJTU_FORK_JOIN_HPP
+#define SJTU_FORK_JOIN_HPP
+
+#include "exceptions.hpp"
+#include "work_stealing_deque.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sjtu
+{
+	//tasks spawned into a group are waited for together
+	class task_group
+	{
+		friend class fork_join_pool;
+
+	private:
+		std::atomic<int> pending;
+
+	public:
+		task_group() : pending(0) {}
+		task_group(const task_group &other) = delete;
+		task_group &operator=(const task_group &other) = delete;
+	};
+
+	//fork-join executor, every worker owns a work_stealing_deque of tasks,
+	//it runs its own newest task first and steals the oldest ones of the others when idle
+	class fork_join_pool
+	{
+	private:
+		struct Task
+		{
+			std::function<void()> fn;
+			task_group *group;
+		};
+
+		struct Worker
+		{
+			fork_join_pool *pool;
+			int id;
+		};
+
+		std::vector<work_stealing_deque<Task*>*> queues;
+		std::vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable wake;
+		std::atomic<bool> active;
+		bool stopping;
+
+	private:
+		static Worker& self()
+		{
+			static thread_local Worker w = {nullptr, -1};
+			return w;
+		}
+
+		int me() const
+		{
+			if (self().pool != this) throw runtime_error(); //not called from a task of this pool
+			return self().id;
+		}
+
+		//run one task, own ones first, false if nothing was found
+		bool runOne(int id)
+		{
+			Task *t;
+			if (!queues[id]->pop_back(t))
+			{
+				int n = queues.size();
+				bool found = false;
+				for (int k = 1; k < n && !found; k++) found = queues[(id + k) % n]->steal(t);
+				if (!found) return false;
+			}
+			t->fn();
+			t->group->pending.fetch_sub(1, std::memory_order_release);
+			delete t;
+			return true;
+		}
+
+		void loop(int id)
+		{
+			self() = Worker{this, id};
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					wake.wait(guard, [&] { return stopping || active.load(); });
+					if (stopping) return;
+				}
+				while (active.load(std::memory_order_acquire))
+				{
+					if (!runOne(id)) std::this_thread::yield();
+				}
+			}
+		}
+
+	public:
+		//threads counts the thread calling run() too
+		explicit fork_join_pool(int threads = std::thread::hardware_concurrency()) : active(false), stopping(false)
+		{
+			if (threads < 1) threads = 1;
+			for (int i = 0; i < threads; i++) queues.push_back(new work_stealing_deque<Task*>());
+			for (int i = 1; i < threads; i++) workers.emplace_back([this, i] { loop(i); });
+		}
+		fork_join_pool(const fork_join_pool &other) = delete;
+		fork_join_pool &operator=(const fork_join_pool &other) = delete;
+		~fork_join_pool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (auto &t : workers) t.join();
+			for (auto q : queues) delete q;
+		}
+
+		int size() const { return queues.size(); }
+
+		//run f on the calling thread as worker 0, the workers help while it runs
+		template<class F>
+		void run(F f)
+		{
+			Worker saved = self();
+			self() = Worker{this, 0};
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				active = true;
+			}
+			wake.notify_all();
+			f();
+			active = false;
+			self() = saved;
+		}
+
+		//only from inside run(), f may spawn and wait itself
+		template<class F>
+		void spawn(task_group &group, F f)
+		{
+			int id = me();
+			group.pending.fetch_add(1, std::memory_order_relaxed);
+			queues[id]->push_back(new Task{std::function<void()>(std::move(f)), &group});
+		}
+
+		//run tasks until all tasks of group are finished
+		void wait(task_group &group)
+		{
+			int id = me();
+			while (group.pending.load(std::memory_order_acquire) > 0)
+			{
+				if (!runOne(id)) std::this_thread::yield();
+			}
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef SJTU_DEQUE_PARALLEL_HPP
+#define SJTU_DEQUE_PARALLEL_HPP
+
+#include "deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sjtu
+{
+	//a fixed set of worker threads, run() spreads tasks 0..n-1 over them and the caller
+	class thread_pool
+	{
+	private:
+		std::vector<std::thread> workers;
+		std::mutex lock;
+		std::condition_variable wake, done;
+		std::function<void(int)> job;
+		int total, busy;
+		std::atomic<int> next, remaining;
+		unsigned long generation;
+		bool active, stopping;
+
+	private:
+		void work()
+		{
+			for (int i = next++; i < total; i = next++)
+			{
+				job(i);
+				if (--remaining == 0)
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					done.notify_all();
+				}
+			}
+		}
+
+		void loop()
+		{
+			unsigned long seen = 0;
+			while (true)
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [&] { return stopping || (active && generation != seen); });
+				if (stopping) return;
+				seen = generation;
+				busy++;
+				guard.unlock();
+				work();
+				guard.lock();
+				busy--;
+				done.notify_all();
+			}
+		}
+
+	public:
+		//threads counts the calling thread too
+		explicit thread_pool(int threads = std::thread::hardware_concurrency())
+			: total(0), busy(0), next(0), remaining(0), generation(0), active(false), stopping(false)
+		{
+			for (int i = 1; i < threads; i++) workers.emplace_back([this] { loop(); });
+		}
+		thread_pool(const thread_pool &other) = delete;
+		thread_pool &operator=(const thread_pool &other) = delete;
+		~thread_pool()
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (auto &t : workers) t.join();
+		}
+
+		int size() const { return workers.size() + 1; }
+
+		//run f(0) .. f(tasks - 1) and wait until all of them are finished
+		void run(int tasks, std::function<void(int)> f)
+		{
+			if (tasks <= 0) return;
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				job = std::move(f);
+				total = tasks;
+				next = 0, remaining = tasks;
+				active = true;
+				generation++;
+			}
+			wake.notify_all();
+			work();
+			std::unique_lock<std::mutex> guard(lock);
+			done.wait(guard, [&] { return remaining == 0 && busy == 0; });
+			active = false;
+		}
+	};
+
+	//a contiguous run of a deque and the index of its first element
+	template<class T>
+	struct deque_segment
+	{
+		T *ptr;
+		int len, index;
+	};
+
+	//the runs of a deque in order, they are the units of work of the parallel algorithms
+	template<class T, int C, int I>
+	std::vector<deque_segment<T>> __segments(deque<T, C, I> &d)
+	{
+		std::vector<deque_segment<T>> res;
+		int index = 0;
+		d.for_each_segment([&](T *p, int len)
+		{
+			res.push_back(deque_segment<T>{p, len, index});
+			index += len;
+		});
+		return res;
+	}
+
+	template<class T, int C, int I>
+	std::vector<deque_segment<const T>> __segments(const deque<T, C, I> &d)
+	{
+		std::vector<deque_segment<const T>> res;
+		int index = 0;
+		d.for_each_segment([&](const T *p, int len)
+		{
+			res.push_back(deque_segment<const T>{p, len, index});
+			index += len;
+		});
+		return res;
+	}
+
+	template<class T, int C, int I, class F>
+	void parallel_for_each(thread_pool &pool, deque<T, C, I> &d, F f)
+	{
+		auto segs = __segments(d);
+		pool.run(segs.size(), [&](int k)
+		{
+			for (int i = 0; i < segs[k].len; i++) f(segs[k].ptr[i]);
+		});
+	}
+
+	//replace every element x by op(x)
+	template<class T, int C, int I, class UnaryOp>
+	void parallel_transform(thread_pool &pool, deque<T, C, I> &d, UnaryOp op)
+	{
+		auto segs = __segments(d);
+		pool.run(segs.size(), [&](int k)
+		{
+			for (int i = 0; i < segs[k].len; i++) segs[k].ptr[i] = op(segs[k].ptr[i]);
+		});
+	}
+
+	//every run is reduced on its own and the partial results are combined in order,
+	//so for an associative op the result does not depend on the number of threads
+	template<class T, int C, int I, class V, class BinaryOp>
+	V parallel_reduce(thread_pool &pool, const deque<T, C, I> &d, V init, BinaryOp op)
+	{
+		auto segs = __segments(d);
+		std::vector<V> partial(segs.size(), init);
+		pool.run(segs.size(), [&](int k)
+		{
+			V acc = segs[k].ptr[0];
+			for (int i = 1; i < segs[k].len; i++) acc = op(acc, segs[k].ptr[i]);
+			partial[k] = acc;
+		});
+		for (auto &x : partial) init = op(init, x);
+		return init;
+	}
+
+	template<class T, int C, int I, class V>
+	V parallel_reduce(thread_pool &pool, const deque<T, C, I> &d, V init)
+	{
+		return parallel_reduce(pool, d, init, [](const V &a, const V &b) { return a + b; });
+	}
+
+	template<class T, int C, int I, class Pred>
+	int parallel_count_if(thread_pool &pool, const deque<T, C, I> &d, Pred pred)
+	{
+		auto segs = __segments(d);
+		std::vector<int> partial(segs.size(), 0);
+		pool.run(segs.size(), [&](int k)
+		{
+			int res = 0;
+			for (int i = 0; i < segs[k].len; i++) res += pred(segs[k].ptr[i]) ? 1 : 0;
+			partial[k] = res;
+		});
+		int res = 0;
+		for (int x : partial) res += x;
+		return res;
+	}
+
+	//sort every chunk in place, then merge neighbouring runs of chunks pairwise, one round at a time,
+	//the merges write into chunks freed by their own inputs, so besides the deque itself only
+	//two spare chunks per thread are allocated
+	template<class T, int C, int I, class Compare = std::less<T>>
+	void parallel_sort(thread_pool &pool, deque<T, C, I> &d, Compare comp = Compare())
+	{
+		d.sort_in_tasks(comp, pool.size(), [&pool](int tasks, std::function<void(int)> f) { pool.run(tasks, std::move(f)); });
+	}
+}
+
+#endif
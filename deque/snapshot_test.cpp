@@ -0,0 +1,116 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include "deque.hpp"
+using namespace std;
+
+//checks that copies of a deque share their chunks until one side writes to them,
+//and a benchmark of snapshots before and after a read loop over the source
+//g++ -std=c++17 -O2 snapshot_test.cpp
+
+const int N = 10000000, Snapshots = 10;
+
+typedef sjtu::deque<int, 64> Deque;
+
+//number of elements of a that are stored in the same place as in b
+int sharedElements(const Deque &a, const Deque &b)
+{
+	int res = 0;
+	for (int i = 0; i < a.size(); i++) res += &a[i] == &b[i] ? 1 : 0;
+	return res;
+}
+
+void check()
+{
+	Deque d;
+	vector<int> model;
+	for (int i = 0; i < 10000; i++) d.push_back(i), model.push_back(i);
+
+	//a read loop through the non-const operator[] does not stop the next copy from sharing
+	long long sum = 0;
+	for (int i = 0; i < d.size(); i++) sum += d[i];
+	Deque snap(d);
+	if (sum != 10000LL * 9999 / 2 || sharedElements(d, snap) != d.size())
+	{
+		cout << "check: snapshot after a read loop is not shallow" << endl;
+		exit(1);
+	}
+
+	//a write clones only the chunk it touches
+	d[5000] = -1;
+	if (snap[5000] != 5000 || sharedElements(d, snap) != d.size() - 64)
+	{
+		cout << "check: a write reached the snapshot or cloned more than one chunk" << endl;
+		exit(1);
+	}
+
+	//structural changes of either side leave the other one as it was
+	d.insert(d.begin() + 1234, 7);
+	d.erase(d.begin() + 20, d.begin() + 300);
+	d.push_front(3);
+	snap.pop_back();
+	snap.sort([](int a, int b) { return a > b; });
+	for (int i = 0; i < snap.size(); i++)
+	{
+		if (snap[i] != 9998 - i)
+		{
+			cout << "check: the snapshot was changed by its source" << endl;
+			exit(1);
+		}
+	}
+	model[5000] = -1;
+	model.insert(model.begin() + 1234, 7);
+	model.erase(model.begin() + 20, model.begin() + 300);
+	model.insert(model.begin(), 3);
+	for (int i = 0; i < d.size(); i++)
+	{
+		if (d[i] != model[i])
+		{
+			cout << "check: the source was changed by its snapshot" << endl;
+			exit(1);
+		}
+	}
+	cout << "check: ok" << endl;
+}
+
+template<class F>
+double timeIt(F f)
+{
+	auto start = chrono::steady_clock::now();
+	f();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+double snapshots(const sjtu::deque<int> &d)
+{
+	vector<sjtu::deque<int>> res;
+	return timeIt([&]
+	{
+		for (int i = 0; i < Snapshots; i++) res.push_back(d);
+	});
+}
+
+int main()
+{
+	check();
+	sjtu::deque<int> d;
+	for (int i = 0; i < N; i++) d.push_back(rand());
+	double before = snapshots(d);
+	long long sum = 0;
+	for (int i = 0; i < d.size(); i++) sum += d[i];
+	double after = snapshots(d);
+	cout << Snapshots << " snapshots of " << N << " ints: " << before << " ms, after a read loop " << after << " ms (sum " << sum << ")" << endl;
+
+	//std::sort goes through the iterators, which check the chunk is not shared on every access
+	sjtu::deque<int> e(d);
+	vector<int> v;
+	for (int i = 0; i < N; i++) v.push_back(d[i]);
+	double t1 = timeIt([&] { std::sort(d.begin(), d.end()); });
+	double t2 = timeIt([&] { e.sort(); });
+	double t3 = timeIt([&] { std::sort(v.begin(), v.end()); });
+	if (!std::is_sorted(d.cbegin(), d.cend()) || !std::is_sorted(e.cbegin(), e.cend())) cout << "not sorted" << endl;
+	cout << "sort of " << N << " ints: std::sort on the deque " << t1 << " ms, deque::sort " << t2 << " ms, std::sort on a vector " << t3 << " ms" << endl;
+	return 0;
+}
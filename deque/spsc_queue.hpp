@@ -0,0 +1,160 @@
+#ifndef SJTU_SPSC_QUEUE_HPP
+#define SJTU_SPSC_QUEUE_HPP
+
+#include "deque.hpp"
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <utility>
+
+namespace sjtu
+{
+	//lock-free queue for exactly one producer thread and one consumer thread,
+	//elements live in a list of chunks like deque, the producer owns the tail chunk
+	//and the consumer owns the head chunk, push and pop never wait on each other
+	template<class T, int ChunkSize = defaultChunkSize<T>()>
+	class spsc_queue
+	{
+		static_assert(ChunkSize > 0, "chunk capacity must be positive");
+
+	private:
+		static const int CacheLine = 64;
+
+		struct Node
+		{
+			std::atomic<int> written; //elements [0, written) are published
+			std::atomic<Node*> next;
+			alignas(T) unsigned char buf[ChunkSize * sizeof(T)];
+
+			Node() : written(0), next(nullptr) {}
+			T* data() { return reinterpret_cast<T*>(buf); }
+		};
+
+		//touched by the producer only
+		struct alignas(CacheLine) Producer
+		{
+			Node *tail;
+			int tailPos;
+			Node *first; //oldest chunk, chunks before the consumer's head chunk are reused
+			Node *headCopy;
+		} prod;
+
+		//touched by the consumer only
+		struct alignas(CacheLine) Consumer
+		{
+			Node *head;
+			int headPos;
+			int avail; //last value read from head->written
+		} cons;
+
+		//the consumer's head chunk, published for the producer to reuse the chunks before it
+		alignas(CacheLine) std::atomic<Node*> headChunk;
+
+	private:
+		Node* newChunk()
+		{
+			if (prod.first == prod.headCopy) prod.headCopy = headChunk.load(std::memory_order_acquire);
+			if (prod.first == prod.headCopy) return new Node();
+			Node *t = prod.first;
+			prod.first = t->next.load(std::memory_order_relaxed);
+			t->written.store(0, std::memory_order_relaxed);
+			t->next.store(nullptr, std::memory_order_relaxed);
+			return t;
+		}
+
+		//make the head chunk the one holding the next element, false if there is none yet
+		bool advance()
+		{
+			if (cons.headPos < cons.avail) return true;
+			if (cons.headPos == ChunkSize)
+			{
+				Node *next = cons.head->next.load(std::memory_order_acquire);
+				if (next == nullptr) return false;
+				cons.head = next;
+				cons.headPos = cons.avail = 0;
+				headChunk.store(next, std::memory_order_release);
+			}
+			cons.avail = cons.head->written.load(std::memory_order_acquire);
+			return cons.headPos < cons.avail;
+		}
+
+	public:
+		spsc_queue()
+		{
+			Node *t = new Node();
+			prod.tail = prod.first = prod.headCopy = t;
+			prod.tailPos = 0;
+			cons.head = t;
+			cons.headPos = cons.avail = 0;
+			headChunk.store(t, std::memory_order_relaxed);
+		}
+		spsc_queue(const spsc_queue &other) = delete;
+		spsc_queue &operator=(const spsc_queue &other) = delete;
+		~spsc_queue()
+		{
+			for (Node *t = cons.head; t != nullptr; t = t->next.load(std::memory_order_relaxed))
+			{
+				int end = t->written.load(std::memory_order_relaxed);
+				for (int i = t == cons.head ? cons.headPos : 0; i < end; i++) t->data()[i].~T();
+			}
+			for (Node *t = prod.first; t != nullptr; )
+			{
+				Node *next = t->next.load(std::memory_order_relaxed);
+				delete t;
+				t = next;
+			}
+		}
+
+		//producer side
+		template<class... Args>
+		void emplace(Args&&... args)
+		{
+			if (prod.tailPos == ChunkSize)
+			{
+				Node *t = newChunk();
+				prod.tail->next.store(t, std::memory_order_release);
+				prod.tail = t;
+				prod.tailPos = 0;
+			}
+			new (prod.tail->data() + prod.tailPos) T(std::forward<Args>(args)...);
+			prod.tail->written.store(++prod.tailPos, std::memory_order_release);
+		}
+
+		void push(const T &value) { emplace(value); }
+		void push(T &&value) { emplace(std::move(value)); }
+
+		//consumer side
+		bool try_pop(T &value)
+		{
+			if (!advance()) return false;
+			T *p = cons.head->data() + cons.headPos++;
+			value = std::move(*p);
+			p->~T();
+			return true;
+		}
+
+		//pop up to n elements into out, return how many were popped
+		template<class OutputIt>
+		int try_pop_n(OutputIt out, int n)
+		{
+			int res = 0;
+			while (res < n && advance())
+			{
+				int len = std::min(n - res, cons.avail - cons.headPos);
+				T *p = cons.head->data() + cons.headPos;
+				for (int i = 0; i < len; i++, ++out)
+				{
+					*out = std::move(p[i]);
+					p[i].~T();
+				}
+				cons.headPos += len;
+				res += len;
+			}
+			return res;
+		}
+
+		bool empty() { return !advance(); }
+	};
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "deque.hpp"
+#include "spsc_queue.hpp"
+using namespace std;
+
+//stress test and throughput benchmark of spsc_queue against a mutex-wrapped deque
+//g++ -std=c++17 -O2 -pthread spsc_test.cpp
+
+const int N = 10000000;
+
+void stress()
+{
+	sjtu::spsc_queue<string, 16> que; //small chunks to cross chunk boundaries often
+	const int M = 1000000;
+	thread producer([&]
+	{
+		for (int i = 0; i < M; i++) que.push(to_string(i));
+	});
+	string buf[37];
+	int expect = 0;
+	while (expect < M)
+	{
+		int got = 0;
+		if (expect % 3 == 0) got = que.try_pop_n(buf, 1 + expect % 37);
+		else got = que.try_pop(buf[0]) ? 1 : 0;
+		for (int i = 0; i < got; i++, expect++)
+		{
+			if (buf[i] != to_string(expect))
+			{
+				cout << "stress: wrong element at " << expect << endl;
+				exit(1);
+			}
+		}
+	}
+	producer.join();
+	if (!que.empty())
+	{
+		cout << "stress: queue not empty" << endl;
+		exit(1);
+	}
+	cout << "stress: ok" << endl;
+}
+
+double benchSpsc(bool batch)
+{
+	sjtu::spsc_queue<int> que;
+	auto start = chrono::steady_clock::now();
+	thread producer([&]
+	{
+		for (int i = 0; i < N; i++) que.push(i);
+	});
+	long long sum = 0;
+	int buf[256];
+	for (int cnt = 0; cnt < N; )
+	{
+		if (batch)
+		{
+			int got = que.try_pop_n(buf, 256);
+			for (int i = 0; i < got; i++) sum += buf[i];
+			cnt += got;
+		}
+		else if (que.try_pop(buf[0])) sum += buf[0], cnt++;
+	}
+	producer.join();
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if (sum != (long long)N * (N - 1) / 2) cout << "wrong sum" << endl;
+	return N / sec / 1e6;
+}
+
+double benchMutex()
+{
+	sjtu::deque<int> que;
+	mutex lock;
+	condition_variable cv;
+	auto start = chrono::steady_clock::now();
+	thread producer([&]
+	{
+		for (int i = 0; i < N; i++)
+		{
+			lock_guard<mutex> guard(lock);
+			que.push_back(i);
+			cv.notify_one();
+		}
+	});
+	long long sum = 0;
+	for (int cnt = 0; cnt < N; cnt++)
+	{
+		unique_lock<mutex> guard(lock);
+		cv.wait(guard, [&] { return !que.empty(); });
+		sum += que.front();
+		que.pop_front();
+	}
+	producer.join();
+	double sec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	if (sum != (long long)N * (N - 1) / 2) cout << "wrong sum" << endl;
+	return N / sec / 1e6;
+}
+
+int main()
+{
+	stress();
+	cout << "spsc_queue try_pop:   " << benchSpsc(false) << " M ops/s" << endl;
+	cout << "spsc_queue try_pop_n: " << benchSpsc(true) << " M ops/s" << endl;
+	cout << "mutex + deque:        " << benchMutex() << " M ops/s" << endl;
+	return 0;
+}
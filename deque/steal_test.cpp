@@ -0,0 +1,115 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "work_stealing_deque.hpp"
+#include "fork_join.hpp"
+using namespace std;
+
+//stress test of work_stealing_deque and fork_join_pool scaling benchmarks
+//g++ -std=c++17 -O2 -pthread steal_test.cpp
+
+void stress()
+{
+	const int M = 2000000, Thieves = 3;
+	sjtu::work_stealing_deque<int> que(2); //start tiny so the ring grows under contention
+	vector<atomic<char>> taken(M);
+	atomic<bool> done(false);
+	atomic<long long> count(0);
+	auto take = [&](int x)
+	{
+		if (taken[x].exchange(1))
+		{
+			cout << "stress: " << x << " taken twice" << endl;
+			exit(1);
+		}
+		count++;
+	};
+	vector<thread> thieves;
+	for (int i = 0; i < Thieves; i++)
+	{
+		thieves.emplace_back([&]
+		{
+			int x;
+			while (!done.load() || !que.empty())
+			{
+				if (que.steal(x)) take(x);
+			}
+		});
+	}
+	int x;
+	for (int i = 0; i < M; i++)
+	{
+		que.push_back(i);
+		if (i % 3 == 0 && que.pop_back(x)) take(x);
+	}
+	while (que.pop_back(x)) take(x);
+	done = true;
+	for (auto &t : thieves) t.join();
+	if (count != M)
+	{
+		cout << "stress: " << count << " of " << M << " taken" << endl;
+		exit(1);
+	}
+	cout << "stress: ok" << endl;
+}
+
+long long fibSeq(int n) { return n < 2 ? n : fibSeq(n - 1) + fibSeq(n - 2); }
+
+long long fib(sjtu::fork_join_pool &pool, int n)
+{
+	if (n < 20) return fibSeq(n);
+	long long a, b;
+	sjtu::task_group group;
+	pool.spawn(group, [&] { a = fib(pool, n - 1); });
+	b = fib(pool, n - 2);
+	pool.wait(group);
+	return a + b;
+}
+
+void quicksort(sjtu::fork_join_pool &pool, int *l, int *r)
+{
+	if (r - l < 10000)
+	{
+		sort(l, r);
+		return;
+	}
+	int pivot = l[(r - l) / 2];
+	int *m1 = partition(l, r, [=](int x) { return x < pivot; });
+	int *m2 = partition(m1, r, [=](int x) { return x == pivot; });
+	sjtu::task_group group;
+	pool.spawn(group, [&] { quicksort(pool, l, m1); });
+	quicksort(pool, m2, r);
+	pool.wait(group);
+}
+
+template<class F>
+double timeIt(F f)
+{
+	auto start = chrono::steady_clock::now();
+	f();
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	stress();
+	int maxThreads = max(4u, thread::hardware_concurrency());
+	vector<int> data(5000000);
+	for (int threads = 1; threads <= maxThreads; threads *= 2)
+	{
+		sjtu::fork_join_pool pool(threads);
+		long long res = 0;
+		double t1 = timeIt([&] { pool.run([&] { res = fib(pool, 36); }); });
+		if (res != fibSeq(36)) cout << "wrong fib" << endl;
+		srand(1);
+		for (auto &x : data) x = rand();
+		double t2 = timeIt([&] { pool.run([&] { quicksort(pool, data.data(), data.data() + data.size()); }); });
+		if (!is_sorted(data.begin(), data.end())) cout << "not sorted" << endl;
+		cout << threads << " threads: fib(36) " << t1 << " ms, quicksort 5M " << t2 << " ms" << endl;
+	}
+	return 0;
+}
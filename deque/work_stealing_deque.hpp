@@ -0,0 +1,119 @@
+#ifndef SJTU_WORK_STEALING_DEQUE_HPP
+#define SJTU_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <type_traits>
+
+namespace sjtu
+{
+	//Chase-Lev work-stealing deque (with the memory orders of Le et al., PPoPP'13):
+	//the owner thread pushes and pops at the back, any other thread may steal from the front,
+	//elements are kept in a circular array that doubles when full
+	template<class T>
+	class work_stealing_deque
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "elements are read racily and must be trivially copyable");
+
+	private:
+		static const int CacheLine = 64;
+
+		struct Ring
+		{
+			long long mask;
+			std::atomic<T> *slots;
+			Ring *retired; //the smaller ring this one replaced, freed with the deque
+
+			Ring(long long cap, Ring *old) : mask(cap - 1), slots(new std::atomic<T>[cap]), retired(old) {}
+			~Ring() { delete [] slots; }
+
+			long long capacity() const { return mask + 1; }
+			T get(long long i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+			void put(long long i, T x) { slots[i & mask].store(x, std::memory_order_relaxed); }
+
+			Ring* grow(long long top, long long bottom)
+			{
+				Ring *res = new Ring(capacity() * 2, this);
+				for (long long i = top; i < bottom; i++) res->put(i, get(i));
+				return res;
+			}
+		};
+
+		alignas(CacheLine) std::atomic<long long> top;
+		alignas(CacheLine) std::atomic<long long> bottom;
+		alignas(CacheLine) std::atomic<Ring*> ring;
+
+	public:
+		//capacity must be a power of 2
+		explicit work_stealing_deque(long long capacity = 64) : top(0), bottom(0), ring(new Ring(capacity, nullptr)) {}
+		work_stealing_deque(const work_stealing_deque &other) = delete;
+		work_stealing_deque &operator=(const work_stealing_deque &other) = delete;
+		~work_stealing_deque()
+		{
+			Ring *r = ring.load(std::memory_order_relaxed);
+			while (r != nullptr)
+			{
+				Ring *old = r->retired;
+				delete r;
+				r = old;
+			}
+		}
+
+		//owner only
+		void push_back(T x)
+		{
+			long long b = bottom.load(std::memory_order_relaxed);
+			long long t = top.load(std::memory_order_acquire);
+			Ring *r = ring.load(std::memory_order_relaxed);
+			if (b - t > r->capacity() - 1)
+			{
+				r = r->grow(t, b);
+				ring.store(r, std::memory_order_release);
+			}
+			r->put(b, x);
+			bottom.store(b + 1, std::memory_order_release); //same as the paper's release fence, and visible to tsan
+		}
+
+		//owner only, false if the deque is empty
+		bool pop_back(T &x)
+		{
+			long long b = bottom.load(std::memory_order_relaxed) - 1;
+			Ring *r = ring.load(std::memory_order_relaxed);
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long t = top.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+			x = r->get(b);
+			if (t < b) return true;
+			//last element, race with the thieves for it
+			bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		//any thread, false if the deque is empty or another thread took the element first
+		bool steal(T &x)
+		{
+			long long t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			long long b = bottom.load(std::memory_order_acquire);
+			if (t >= b) return false;
+			Ring *r = ring.load(std::memory_order_acquire);
+			x = r->get(t);
+			return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		//only a snapshot when other threads are active
+		long long size() const
+		{
+			long long b = bottom.load(std::memory_order_relaxed), t = top.load(std::memory_order_relaxed);
+			return b > t ? b - t : 0;
+		}
+		bool empty() const { return size() == 0; }
+	};
+}
+
+#endif
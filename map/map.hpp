@@ -1,16 +1,25 @@
 #ifndef SJTU_MAP_HPP
 #define SJTU_MAP_HPP
 
+#if __cplusplus < 201703L && (!defined(_MSVC_LANG) || _MSVC_LANG < 201703L)
+#error "this header needs C++17"
+#endif
+
 #include <functional>
+#include <climits>
 #include <cstddef>
 #include <iostream>
+#include <new>
+#include <type_traits>
 #include "utility.hpp"
 #include "exceptions.hpp"
 
 namespace sjtu
 {
 
-	template<class Key, class T, class Compare = std::less<Key>>
+	//with OrderStatistics every node also keeps the size of its subtree,
+	//which gives rank(), select(), count_range() and iterator differences in O(log n)
+	template<class Key, class T, class Compare = std::less<Key>, bool OrderStatistics = false>
 	class map
 	{
 	public:
@@ -18,56 +27,250 @@ namespace sjtu
 		enum Color { RED, BLACK };
 
 	private:
+		struct Uncounted {};
 		struct Node
 		{
 			Node *left, *right, *father;
 			Color color;
+			typename std::conditional<OrderStatistics, int, Uncounted>::type sub; //nodes in the subtree, fits in the padding after color
 			value_type kvpair;
-			Node(const value_type &kv, Color c = RED) : left(nullptr), right(nullptr), father(nullptr), color(c), kvpair(kv) {}
+			template<class... Args>
+			Node(Color c, Args&&... args) : left(nullptr), right(nullptr), father(nullptr), color(c), kvpair(std::forward<Args>(args)...) {}
+		};
+
+	public:
+		//nodes are carved from blocks in allocation order and freed nodes are kept in an intrusive
+		//free list, so neighbours in time are neighbours in memory and erase/insert do not hit malloc,
+		//every map has its own pool unless it is given one to share with other maps
+		class node_pool
+		{
+			friend class map;
+
+		private:
+			union Slot
+			{
+				Slot *next; //while in the free list
+				alignas(Node) unsigned char raw[sizeof(Node)];
+			};
+			struct alignas(Slot) Block
+			{
+				Block *next;
+				int cap;
+				Slot* slots() { return reinterpret_cast<Slot*>(this + 1); }
+			};
+			static const int MinBlock = 16, MaxBlock = 4096; //blocks double up to MaxBlock nodes
+
+			Block *blocks; //newest first
+			int carved; //slots of the newest block handed out so far
+			Slot *freeList;
+			size_t live;
+			int blockCount;
+
+		public:
+			node_pool() : blocks(nullptr), carved(0), freeList(nullptr), live(0), blockCount(0) {}
+			node_pool(const node_pool &other) = delete;
+			node_pool &operator=(const node_pool &other) = delete;
+			~node_pool() { release(); }
+
+			size_t live_nodes() const { return live; }
+			int block_count() const { return blockCount; }
+
+			//make room for n nodes side by side at the end of the newest block, a bulk build carves
+			//them from there in order, what is left of the current block goes to the free list
+			void reserve(size_t n)
+			{
+				if (blocks != nullptr && (size_t)(blocks->cap - carved) >= n) return;
+				while (blocks != nullptr && carved < blocks->cap)
+				{
+					Slot *s = blocks->slots() + carved++;
+					s->next = freeList;
+					freeList = s;
+				}
+				addBlock(n > (size_t)INT_MAX ? INT_MAX : (int)n);
+			}
+
+		private:
+			void addBlock(int cap)
+			{
+				Block *b = static_cast<Block*>(::operator new(sizeof(Block) + (size_t)cap * sizeof(Slot)));
+				b->next = blocks, b->cap = cap;
+				blocks = b, carved = 0;
+				blockCount++;
+			}
+
+			//a slot from the newest block, skipping the free list, so consecutive calls give adjacent nodes
+			Node* carve()
+			{
+				if (blocks == nullptr || carved == blocks->cap) addBlock(blocks == nullptr ? MinBlock : blocks->cap < MaxBlock ? blocks->cap * 2 : MaxBlock);
+				live++;
+				return reinterpret_cast<Node*>(blocks->slots() + carved++);
+			}
+
+			Node* allocate()
+			{
+				Slot *s = freeList;
+				if (s == nullptr) return carve();
+				freeList = s->next;
+				live++;
+				return reinterpret_cast<Node*>(s);
+			}
+
+			void deallocate(Node *t)
+			{
+				Slot *s = reinterpret_cast<Slot*>(t);
+				s->next = freeList;
+				freeList = s;
+				live--;
+			}
+
+			//free every block at once, the nodes in them must already be destroyed
+			void release()
+			{
+				while (blocks != nullptr)
+				{
+					Block *b = blocks;
+					blocks = b->next;
+					::operator delete(b);
+				}
+				carved = 0, freeList = nullptr, live = 0, blockCount = 0;
+			}
 		};
+
 	private:
+		node_pool ownPool;
+		node_pool *pool;
 		Node *root;
+		Node *leftMost, *rightMost; //the first and the last node, nullptr when empty
 		size_t __size;
 
 	private:
+		template<class... Args>
+		Node* newNode(Color c, Args&&... args)
+		{
+			return construct(pool->allocate(), c, std::forward<Args>(args)...);
+		}
+
+		template<class... Args>
+		Node* construct(Node *t, Color c, Args&&... args)
+		{
+			try
+			{
+				return new (t) Node(c, std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				pool->deallocate(t);
+				throw;
+			}
+		}
+
+		void deleteNode(Node *t)
+		{
+			t->~Node();
+			pool->deallocate(t);
+		}
+
 		void __clear(Node *t)
 		{
 			if (t == nullptr) return;
 			__clear(t->left);
 			__clear(t->right);
-			delete t;
+			deleteNode(t);
+		}
+
+		//a map with its own pool skips the walk when there are no destructors to run
+		//and then frees whole blocks
+		void clearAll()
+		{
+			if (pool != &ownPool || !std::is_trivially_destructible<value_type>::value) __clear(root);
+			if (pool == &ownPool) ownPool.release();
+			root = leftMost = rightMost = nullptr;
+			__size = 0;
+		}
+
+		void findEnds()
+		{
+			leftMost = rightMost = root;
+			if (root == nullptr) return;
+			while (leftMost->left != nullptr) leftMost = leftMost->left;
+			while (rightMost->right != nullptr) rightMost = rightMost->right;
+		}
+
+		//a perfectly balanced tree of the next n elements of it, with nodes allocated in order,
+		//all levels above redDepth are full, so making exactly the nodes on that level red
+		//gives every path the same number of black nodes,
+		//if copying an element throws, the nodes built so far are destroyed before it propagates
+		template<class ForwardIt>
+		Node* build(ForwardIt &it, size_t n, int depth, int redDepth)
+		{
+			if (n == 0) return nullptr;
+			Node *l = build(it, (n - 1) / 2, depth + 1, redDepth), *t;
+			try
+			{
+				t = construct(pool->carve(), depth == redDepth ? RED : BLACK, *it);
+			}
+			catch (...)
+			{
+				__clear(l);
+				throw;
+			}
+			t->left = l;
+			if (l != nullptr) l->father = t;
+			try
+			{
+				++it;
+				t->right = build(it, n - 1 - (n - 1) / 2, depth + 1, redDepth);
+			}
+			catch (...)
+			{
+				__clear(t);
+				throw;
+			}
+			if (t->right != nullptr) t->right->father = t;
+			if constexpr (OrderStatistics) t->sub = n;
+			return t;
 		}
 
 		Node* __dfs(Node *other, Node *p = nullptr)
 		{
 			if (other == nullptr) return nullptr;
-			Node *t = new Node(other->kvpair, other->color);
+			Node *t = newNode(other->color, other->kvpair);
 			t->father = p;
+			if constexpr (OrderStatistics) t->sub = other->sub;
 			t->left = __dfs(other->left, t);
 			t->right = __dfs(other->right, t);
 			return t;
 		}
 
 	public:
-		map() : root(nullptr), __size(0) {}
-		map(const map &other)
+		map() : pool(&ownPool), root(nullptr), leftMost(nullptr), rightMost(nullptr), __size(0) {}
+		//allocate nodes from shared, which must outlive the map
+		explicit map(node_pool &shared) : pool(&shared), root(nullptr), leftMost(nullptr), rightMost(nullptr), __size(0) {}
+		template<class ForwardIt>
+		map(ForwardIt first, ForwardIt last) : pool(&ownPool), root(nullptr), leftMost(nullptr), rightMost(nullptr), __size(0)
+		{
+			assign(first, last);
+		}
+		map(const map &other) : pool(&ownPool), root(nullptr), leftMost(nullptr), rightMost(nullptr), __size(0)
 		{
 			root = __dfs(other.root);
+			findEnds();
 			__size = other.__size;
 		}
 
 		map &operator=(const map &other)
 		{
 			if (this == &other) return *this;
-			__clear(root);
+			clearAll();
 			root = __dfs(other.root);
+			findEnds();
 			__size = other.__size;
 			return *this;
 		}
 
 		~map()
 		{
-			__clear(root);
+			clearAll();
 		}
 
 	public:
@@ -115,8 +318,7 @@ namespace sjtu
 				if (cur == nullptr) //end()
 				{
 					if (corres->empty()) throw invalid_iterator();
-					cur = corres->root;
-					while (cur->right != nullptr) cur = cur->right;
+					cur = corres->rightMost;
 				}
 				else if (cur->left != nullptr)
 				{
@@ -138,6 +340,14 @@ namespace sjtu
 				return t;
 			}
 
+			//only with OrderStatistics
+			template<bool B = OrderStatistics, typename std::enable_if<B, int>::type = 0>
+			std::ptrdiff_t operator-(const iterator &rhs) const
+			{
+				if (corres != rhs.corres) throw invalid_iterator();
+				return (std::ptrdiff_t)corres->indexOfNode(cur) - (std::ptrdiff_t)corres->indexOfNode(rhs.cur);
+			}
+
 			value_type & operator*() const { return cur->kvpair; }
 			value_type* operator->() const noexcept { return &(cur->kvpair); }
 
@@ -189,8 +399,7 @@ namespace sjtu
 				if (cur == nullptr) //end()
 				{
 					if (corres->empty()) throw invalid_iterator();
-					cur = corres->root;
-					while (cur->right != nullptr) cur = cur->right;
+					cur = corres->rightMost;
 				}
 				else if (cur->left != nullptr)
 				{
@@ -212,6 +421,14 @@ namespace sjtu
 				return t;
 			}
 
+			//only with OrderStatistics
+			template<bool B = OrderStatistics, typename std::enable_if<B, int>::type = 0>
+			std::ptrdiff_t operator-(const const_iterator &rhs) const
+			{
+				if (corres != rhs.corres) throw invalid_iterator();
+				return (std::ptrdiff_t)corres->indexOfNode(cur) - (std::ptrdiff_t)corres->indexOfNode(rhs.cur);
+			}
+
 			const value_type & operator*() const { return cur->kvpair; }
 			const value_type* operator->() const noexcept { return &(cur->kvpair); }
 
@@ -225,11 +442,58 @@ namespace sjtu
 			return t->father != nullptr && t->father->left == t;
 		}
 
+		static Node* nextNode(Node *t)
+		{
+			if (t->right != nullptr)
+			{
+				t = t->right;
+				while (t->left != nullptr) t = t->left;
+				return t;
+			}
+			while (t->father != nullptr && !isLeftSon(t)) t = t->father;
+			return t->father;
+		}
+
+		static Node* prevNode(Node *t)
+		{
+			if (t->left != nullptr)
+			{
+				t = t->left;
+				while (t->right != nullptr) t = t->right;
+				return t;
+			}
+			while (t->father != nullptr && isLeftSon(t)) t = t->father;
+			return t->father;
+		}
+
 		Color getColor(Node *t)
 		{
 			return (t == nullptr || t->color == BLACK) ? BLACK : RED;
 		}
 
+		static size_t subSize(Node *t)
+		{
+			if constexpr (OrderStatistics) return t == nullptr ? 0 : t->sub;
+			else return 0;
+		}
+
+		static void resize(Node *t)
+		{
+			if constexpr (OrderStatistics) t->sub = 1 + subSize(t->left) + subSize(t->right);
+		}
+
+		//number of elements before t, t is nullptr for end()
+		size_t indexOfNode(Node *t) const
+		{
+			if (t == nullptr) return __size;
+			size_t res = subSize(t->left);
+			for (; t->father != nullptr; t = t->father)
+			{
+				if (!isLeftSon(t)) res += subSize(t->father->left) + 1;
+			}
+			return res;
+		}
+
 	private:
 		void leftRotate(Node *x)
 		{
@@ -242,6 +506,8 @@ namespace sjtu
 			else x->father->right = y;
 			y->left = x;
 			x->father = y;
+			resize(x);
+			resize(y);
 		}
 
 		void rightRotate(Node *x)
@@ -255,6 +521,8 @@ namespace sjtu
 			else x->father->right = y;
 			y->right = x;
 			x->father = y;
+			resize(x);
+			resize(y);
 		}
 
 	private:
@@ -386,25 +654,149 @@ namespace sjtu
 		}
 
 	private:
-		iterator __insert(const value_type &value)
+		//find key, or else the empty slot where it belongs
+		Node* descend(const Key &key, Node *&parent, bool &left) const
+		{
+			Node *t = root;
+			parent = nullptr, left = false;
+			while (t != nullptr)
+			{
+				if (Compare()(key, t->kvpair.first)) parent = t, left = true, t = t->left;
+				else if (Compare()(t->kvpair.first, key)) parent = t, left = false, t = t->right;
+				else return t;
+			}
+			return nullptr;
+		}
+
+		//the empty slot for key right before or right after h (h is nullptr for end()),
+		//false if key does not fall in either gap, O(1) at the ends of the map, otherwise at most one walk to a neighbour
+		bool slotNear(Node *h, const Key &key, Node *&parent, bool &left) const
+		{
+			if (h == nullptr || Compare()(key, h->kvpair.first))
+			{
+				Node *p = h == nullptr ? rightMost : h == leftMost ? nullptr : prevNode(h);
+				if (p != nullptr && !Compare()(p->kvpair.first, key)) return false;
+				if (h != nullptr && h->left == nullptr) parent = h, left = true;
+				else parent = p, left = false;
+				return true;
+			}
+			if (!Compare()(h->kvpair.first, key)) return false;
+			Node *n = h == rightMost ? nullptr : nextNode(h);
+			if (n != nullptr && !Compare()(key, n->kvpair.first)) return false;
+			if (h->right == nullptr) parent = h, left = false;
+			else parent = n, left = true;
+			return true;
+		}
+
+		//link the new node z into a slot found by descend() or slotNear()
+		iterator link(Node *z, Node *parent, bool left)
 		{
 			__size++;
-			Node *z = new Node(value);
-			Node *x = root, *y = nullptr;
-			while (x != nullptr)
-			{
-				y = x;
-				if (Compare()(value.first, x->kvpair.first)) x = x->left;
-				else x = x->right;
-			}
-			z->father = y;
-			if (y == nullptr) root = z;
-			else if (Compare()(value.first, y->kvpair.first)) y->left = z;
-			else y->right = z;
+			z->father = parent;
+			if (parent == nullptr) root = z;
+			else if (left) parent->left = z;
+			else parent->right = z;
+			if (leftMost == nullptr || (parent == leftMost && left)) leftMost = z;
+			if (rightMost == nullptr || (parent == rightMost && !left)) rightMost = z;
+			if constexpr (OrderStatistics)
+			{
+				z->sub = 1;
+				for (Node *p = parent; p != nullptr; p = p->father) p->sub++;
+			}
 			insertFixup(z);
 			return iterator(z, this);
 		}
 
+		Node* selectNode(size_t k) const
+		{
+			if (k >= __size) throw index_out_of_bound();
+			Node *t = root;
+			while (true)
+			{
+				size_t l = subSize(t->left);
+				if (k == l) return t;
+				if (k < l) t = t->left;
+				else k -= l + 1, t = t->right;
+			}
+		}
+
+		//the first node not less than key / greater than key, nullptr if there is none
+		Node* lowerNode(const Key &key) const
+		{
+			Node *t = root, *res = nullptr;
+			while (t != nullptr)
+			{
+				if (Compare()(t->kvpair.first, key)) t = t->right;
+				else res = t, t = t->left;
+			}
+			return res;
+		}
+
+		Node* upperNode(const Key &key) const
+		{
+			Node *t = root, *res = nullptr;
+			while (t != nullptr)
+			{
+				if (Compare()(key, t->kvpair.first)) res = t, t = t->left;
+				else t = t->right;
+			}
+			return res;
+		}
+
+		//in-order walks of a subtree for range scans, every node of walkAll's subtree is in range
+		//and the other two only compare against the one bound that can still fail
+		template<class F>
+		static void walkAll(Node *t, F &f)
+		{
+			while (t != nullptr)
+			{
+				walkAll(t->left, f);
+				f(t);
+				t = t->right;
+			}
+		}
+
+		template<class F>
+		static void walkFrom(Node *t, const Key &lo, F &f)
+		{
+			while (t != nullptr && Compare()(t->kvpair.first, lo)) t = t->right;
+			if (t == nullptr) return;
+			walkFrom(t->left, lo, f);
+			f(t);
+			walkAll(t->right, f);
+		}
+
+		template<class F>
+		static void walkBelow(Node *t, const Key &hi, F &f)
+		{
+			while (t != nullptr)
+			{
+				if (!Compare()(t->kvpair.first, hi)) t = t->left;
+				else
+				{
+					walkAll(t->left, f);
+					f(t);
+					t = t->right;
+				}
+			}
+		}
+
+		template<class F>
+		void walkRange(const Key &lo, const Key &hi, F &f) const
+		{
+			Node *t = root;
+			while (t != nullptr)
+			{
+				if (Compare()(t->kvpair.first, lo)) t = t->right;
+				else if (!Compare()(t->kvpair.first, hi)) t = t->left;
+				else break;
+			}
+			if (t == nullptr) return;
+			walkFrom(t->left, lo, f);
+			f(t);
+			walkBelow(t->right, hi, f);
+		}
+
 		inline void __change(Node *a, Node *b) //change relatives with a to with b
 		{
 			if (a->left != nullptr) a->left->father = b;
@@ -420,6 +812,7 @@ namespace sjtu
 		{
 			Color ac = a->color, bc = b->color;
 			a->color = bc, b->color = ac;
+			if constexpr (OrderStatistics) std::swap(a->sub, b->sub); //the subtree sizes stay with the positions
 			//special case where a is the father of b and b is the left son
 			if (b->father == a)
 			{
@@ -451,6 +844,8 @@ namespace sjtu
 		{
 			__size--;
 			Node *z = pos.cur, *x, *y;
+			if (z == leftMost) leftMost = nextNode(z);
+			if (z == rightMost) rightMost = prevNode(z);
 			if (z->right == nullptr || z->left == nullptr) y = z;
 			else
 			{
@@ -469,34 +864,48 @@ namespace sjtu
 			if (y->father == nullptr) root = x; //y is the root
 			else if (isLeftSon(y)) y->father->left = x;
 			else y->father->right = x;
+			if constexpr (OrderStatistics)
+			{
+				for (Node *p = y->father; p != nullptr; p = p->father) p->sub--;
+			}
 
 			if (y->color == BLACK) eraseFixup(x, y->father, isLeft);
-			delete y;
+			deleteNode(y);
 		}
 
 	public:
 		bool empty() const { return __size == 0; }
 		size_t size() const { return __size; }
-		void clear()
+		void clear() { clearAll(); }
+
+		//replace the content with [first, last), the longest prefix with strictly increasing keys
+		//is built directly in O(n), the remaining elements are inserted one by one
+		template<class ForwardIt>
+		void assign(ForwardIt first, ForwardIt last)
 		{
-			__clear(root);
-			root = nullptr;
-			__size = 0;
+			clearAll();
+			if (first == last) return;
+			size_t n = 1;
+			ForwardIt prev = first, rest = first;
+			for (++rest; rest != last && Compare()((*prev).first, (*rest).first); ++rest) prev = rest, n++;
+			int redDepth = 0;
+			while (((size_t)2 << redDepth) <= n + 1) redDepth++;
+			pool->reserve(n);
+			root = build(first, n, 0, redDepth);
+			__size = n;
+			findEnds();
+			for (; rest != last; ++rest) insert(end(), *rest);
 		}
 
 	public:
 		iterator begin()
 		{
 			if (empty()) return end();
-			Node *leftMost = root;
-			while (leftMost->left != nullptr) leftMost = leftMost->left;
 			return iterator(leftMost, this);
 		}
 		const_iterator cbegin() const
 		{
 			if (empty()) return cend();
-			Node *leftMost = root;
-			while (leftMost->left != nullptr) leftMost = leftMost->left;
 			return const_iterator(leftMost, this);
 		}
 
@@ -540,19 +949,72 @@ namespace sjtu
 			return iter->second;
 		}
 
-		T& operator[](const Key &key)
-		{
-			iterator iter = find(key);
-			if (iter == end()) return insert(value_type(key, T())).first.cur->kvpair.second;
-			else return iter->second;
-		}
+		T& operator[](const Key &key) { return try_emplace(key).first->second; }
 		const T & operator[](const Key &key) const { return at(key); }
 
 		pair<iterator, bool> insert(const value_type &value)
 		{
-			iterator t = find(value.first);
-			if (t != end()) return pair<iterator, bool>(t, false);
-			else return pair<iterator, bool>(__insert(value), true);
+			Node *parent;
+			bool left;
+			Node *t = descend(value.first, parent, left);
+			if (t != nullptr) return pair<iterator, bool>(iterator(t, this), false);
+			return pair<iterator, bool>(link(newNode(RED, value), parent, left), true);
+		}
+
+		//insert value as close as possible before hint, amortized O(1) when it belongs right before
+		//or right after hint, e.g. a sorted load with end() or the previous result as the hint
+		iterator insert(iterator hint, const value_type &value)
+		{
+			if (hint.corres != this) throw invalid_iterator();
+			Node *parent;
+			bool left;
+			if (!slotNear(hint.cur, value.first, parent, left))
+			{
+				Node *t = descend(value.first, parent, left);
+				if (t != nullptr) return iterator(t, this);
+			}
+			return link(newNode(RED, value), parent, left);
+		}
+
+		//the value is built before the lookup, the node is thrown away if the key exists
+		template<class... Args>
+		pair<iterator, bool> emplace(Args&&... args)
+		{
+			Node *z = newNode(RED, std::forward<Args>(args)...);
+			Node *parent;
+			bool left;
+			Node *t = descend(z->kvpair.first, parent, left);
+			if (t != nullptr)
+			{
+				deleteNode(z);
+				return pair<iterator, bool>(iterator(t, this), false);
+			}
+			return pair<iterator, bool>(link(z, parent, left), true);
+		}
+
+		//nothing is constructed if the key exists
+		template<class... Args>
+		pair<iterator, bool> try_emplace(const Key &key, Args&&... args)
+		{
+			Node *parent;
+			bool left;
+			Node *t = descend(key, parent, left);
+			if (t != nullptr) return pair<iterator, bool>(iterator(t, this), false);
+			return pair<iterator, bool>(link(newNode(RED, key, T(std::forward<Args>(args)...)), parent, left), true);
+		}
+
+		template<class M>
+		pair<iterator, bool> insert_or_assign(const Key &key, M &&obj)
+		{
+			Node *parent;
+			bool left;
+			Node *t = descend(key, parent, left);
+			if (t != nullptr)
+			{
+				t->kvpair.second = std::forward<M>(obj);
+				return pair<iterator, bool>(iterator(t, this), false);
+			}
+			return pair<iterator, bool>(link(newNode(RED, key, std::forward<M>(obj)), parent, left), true);
 		}
 
 		void erase(iterator pos)
@@ -562,6 +1024,67 @@ namespace sjtu
 		}
 
 		size_t count(const Key &key) const { return find(key) != cend(); }
+
+		//first element not less than key and first element greater than key
+		iterator lower_bound(const Key &key) { return iterator(lowerNode(key), this); }
+		const_iterator lower_bound(const Key &key) const { return const_iterator(lowerNode(key), this); }
+		iterator upper_bound(const Key &key) { return iterator(upperNode(key), this); }
+		const_iterator upper_bound(const Key &key) const { return const_iterator(upperNode(key), this); }
+
+		pair<iterator, iterator> equal_range(const Key &key)
+		{
+			Node *t = lowerNode(key);
+			if (t == nullptr || Compare()(key, t->kvpair.first)) return pair<iterator, iterator>(iterator(t, this), iterator(t, this));
+			return pair<iterator, iterator>(iterator(t, this), iterator(nextNode(t), this));
+		}
+		pair<const_iterator, const_iterator> equal_range(const Key &key) const
+		{
+			Node *t = lowerNode(key);
+			if (t == nullptr || Compare()(key, t->kvpair.first)) return pair<const_iterator, const_iterator>(const_iterator(t, this), const_iterator(t, this));
+			return pair<const_iterator, const_iterator>(const_iterator(t, this), const_iterator(nextNode(t), this));
+		}
+
+		//call f(value) for every element with a key in [lo, hi) in order, the tree is walked
+		//top-down so no step climbs back through the parents as iterator increments do
+		template<class F>
+		void for_each_in_range(const Key &lo, const Key &hi, F f)
+		{
+			auto visit = [&f](Node *t) { f(t->kvpair); };
+			walkRange(lo, hi, visit);
+		}
+		template<class F>
+		void for_each_in_range(const Key &lo, const Key &hi, F f) const
+		{
+			auto visit = [&f](Node *t) { f(static_cast<const value_type&>(t->kvpair)); };
+			walkRange(lo, hi, visit);
+		}
+
+		//number of keys less than key, this one and the two below only exist with OrderStatistics
+		template<bool B = OrderStatistics, typename std::enable_if<B, int>::type = 0>
+		size_t rank(const Key &key) const
+		{
+			size_t res = 0;
+			for (Node *t = root; t != nullptr; )
+			{
+				if (Compare()(t->kvpair.first, key)) res += subSize(t->left) + 1, t = t->right;
+				else t = t->left;
+			}
+			return res;
+		}
+
+		//the element with k smaller keys
+		template<bool B = OrderStatistics, typename std::enable_if<B, int>::type = 0>
+		iterator select(size_t k) { return iterator(selectNode(k), this); }
+		template<bool B = OrderStatistics, typename std::enable_if<B, int>::type = 0>
+		const_iterator select(size_t k) const { return const_iterator(selectNode(k), this); }
+
+		//number of keys in [lo, hi)
+		template<bool B = OrderStatistics, typename std::enable_if<B, int>::type = 0>
+		size_t count_range(const Key &lo, const Key &hi) const
+		{
+			if (!Compare()(lo, hi)) return 0;
+			return rank(hi) - rank(lo);
+		}
 	};
 
 }
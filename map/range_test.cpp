@@ -0,0 +1,105 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include "map.hpp"
+using namespace std;
+
+//checks of lower_bound/upper_bound/equal_range/for_each_in_range against std::map and
+//a benchmark of range scans of several selectivities, comparing a scan from begin(),
+//lower_bound followed by iterator increments, and for_each_in_range
+//g++ -std=c++17 -O2 range_test.cpp
+
+const int N = 1000000, Queries = 200;
+
+void check()
+{
+	sjtu::map<int, int> m;
+	std::map<int, int> s;
+	for (int i = 0; i < 20000; i++)
+	{
+		int k = rand() % 50000;
+		m[k] = i, s[k] = i;
+	}
+	for (int i = 0; i < 20000; i++)
+	{
+		int a = rand() % 50010 - 5, b = a + rand() % 3000;
+		auto l = m.lower_bound(a);
+		auto u = m.upper_bound(a);
+		auto r = m.equal_range(a);
+		auto sl = s.lower_bound(a), su = s.upper_bound(a);
+		if ((l == m.end()) != (sl == s.end()) || (l != m.end() && l->first != sl->first)
+			|| (u == m.end()) != (su == s.end()) || (u != m.end() && u->first != su->first)
+			|| r.first != l || r.second != u)
+		{
+			cout << "check: bounds of " << a << " differ" << endl;
+			exit(1);
+		}
+		auto it = s.lower_bound(a);
+		bool ok = true;
+		m.for_each_in_range(a, b, [&](const sjtu::map<int, int>::value_type &p)
+		{
+			if (it == s.end() || it->first != p.first || it->second != p.second) ok = false;
+			else ++it;
+		});
+		if (!ok || (it != s.end() && it->first < b))
+		{
+			cout << "check: range [" << a << ", " << b << ") differs" << endl;
+			exit(1);
+		}
+	}
+	cout << "check: ok" << endl;
+}
+
+template<class F>
+double timeIt(F f)
+{
+	auto start = chrono::steady_clock::now();
+	f();
+	return chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	check();
+	sjtu::map<int, int> m;
+	vector<int> keys;
+	for (int i = 0; i < N; i++) keys.push_back(i * 4);
+	for (int i = N - 1; i > 0; i--) swap(keys[i], keys[rand() % (i + 1)]); //random insertion order scatters the nodes
+	for (int k : keys) m[k] = k;
+	const double selectivity[] = { 0.00001, 0.0001, 0.001, 0.01, 0.1 };
+	for (double sel : selectivity)
+	{
+		int width = sel * N * 4;
+		vector<int> lo;
+		for (int i = 0; i < Queries; i++) lo.push_back(rand() % (N * 4 - width));
+		long long s1 = 0, s2 = 0, s3 = 0;
+		double t1 = sel > 0.001 ? 0 : timeIt([&]
+		{
+			for (int a : lo)
+			{
+				for (auto it = m.begin(); it != m.end() && it->first < a + width; ++it)
+				{
+					if (it->first >= a) s1 += it->second;
+				}
+			}
+		});
+		double t2 = timeIt([&]
+		{
+			for (int a : lo)
+			{
+				for (auto it = m.lower_bound(a); it != m.end() && it->first < a + width; ++it) s2 += it->second;
+			}
+		});
+		double t3 = timeIt([&]
+		{
+			for (int a : lo) m.for_each_in_range(a, a + width, [&](const sjtu::map<int, int>::value_type &p) { s3 += p.second; });
+		});
+		if ((t1 > 0 && s1 != s2) || s2 != s3) cout << "wrong sum" << endl;
+		cout << "selectivity " << sel * 100 << "% (" << width / 4 << " keys): ";
+		if (t1 > 0) cout << "from begin() " << t1 / Queries << " us, ";
+		cout << "lower_bound + ++ " << t2 / Queries << " us, for_each_in_range " << t3 / Queries << " us per query" << endl;
+	}
+	return 0;
+}